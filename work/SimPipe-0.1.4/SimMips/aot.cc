@@ -0,0 +1,109 @@
+/**********************************************************************
+ * SimMips: Simple Computer Simulator of MIPS    Arch Lab. TOKYO TECH *
+ **********************************************************************/
+#include "define.h"
+
+/**********************************************************************/
+MipsAot::MipsAot(Mips *mips, MipsAotImage *image)
+{
+    this->mips = mips;
+    this->image = image;
+    hostpage = NULL;
+    codepage = NULL;
+    textbase = image->textbase;
+    textsize = image->textsize;
+    checked = 0;
+    dirty = 0;
+}
+
+/**********************************************************************/
+int MipsAot::check()
+{
+    // the text loaded must be the one translated by mips2c
+    MemoryController *mc = mips->mc;
+    uint032_t sum = 2166136261u;
+    for (uint032_t i = 0; i < textsize; i++) {
+        int mcid = mc->enqueue(textbase + i, 1, NULL);
+        if ((mcid < 0) || (mc->inst[mcid].state == MCI_FAILURE))
+            break;
+        sum = (sum ^ mc->inst[mcid].data008) * 16777619u;
+    }
+    if (sum != image->textsum) {
+        fprintf(stderr, "## text differs from %s, not translated.\n",
+                image->name);
+        dirty = 1;
+        return 1;
+    }
+    hostpage = mips->hostpage;
+    codepage = mips->ic->codepage;
+    return 0;
+}
+
+/**********************************************************************/
+uint064_t MipsAot::run(uint064_t limit)
+{
+    if (!checked) {
+        checked = 1;
+        check();
+    }
+    if ((dirty) || (mips->as->delay_npc))
+        return 0;
+    return image->run(this, mips->as, limit);
+}
+
+/**********************************************************************/
+int MipsAot::loadslow(uint032_t addr, int size, uint032_t *data)
+{
+    MemoryController *mc = mips->mc;
+    int mcid = mc->enqueue(addr, size, NULL);
+    if ((mcid < 0) || (mc->inst[mcid].state == MCI_FAILURE))
+        return 0;
+    *data = (size == 1) ? mc->inst[mcid].data008 :
+        (size == 2) ? mc->inst[mcid].data016 : mc->inst[mcid].data032;
+    mips->maphost(addr);
+    return 1;
+}
+
+/**********************************************************************/
+int MipsAot::storeslow(uint032_t addr, int size, uint032_t data)
+{
+    uint008_t data008 = (uint008_t) data;
+    uint016_t data016 = (uint016_t) data;
+    mips->ic->checkstore(addr);
+    mips->mc->enqueue(addr, size, (size == 1) ? (void *) &data008 :
+                      (size == 2) ? (void *) &data016 : (void *) &data);
+    mips->maphost(addr);
+
+    // the translated code is not run any more once its text is written
+    if (addr - textbase < textsize) {
+        dirty = 1;
+        return 0;
+    }
+    return 1;
+}
+
+/**********************************************************************/
+void MipsAot::branchzero()
+{
+    printf("## Branch to zero. stop.\n");
+    mips->state = CPU_ERROR;
+}
+
+/**********************************************************************/
+int mips_aot_main(int argc, char *argv[], MipsAotImage *image)
+{
+    printf("## %s %s\n", L_NAME, L_VER);
+
+    Board *board = new Board();
+    board->engine = ENGINE_AOT;
+    board->aotimage = image;
+
+    // execute if successfully initialized
+    if (board->siminit(argc, argv) == 0)
+        board->exec();
+
+    DELETE(board);
+    return 0;
+}
+
+/**********************************************************************/
@@ -0,0 +1,124 @@
+/**********************************************************************
+ * SimMips: Simple Computer Simulator of MIPS    Arch Lab. TOKYO TECH *
+ **********************************************************************/
+#include "define.h"
+
+/* A basic block vector counts, for an interval of insts, the insts run
+ * in each basic block.  The vectors are written in the .bb format of
+ * SimPoint, "T:id:count :id:count ..." a line, after a header line
+ * "# interval num".  A block ends with the delay slot of a branch, at
+ * an eret, or where the pc does not go on sequentially. */
+
+/**********************************************************************/
+BbvProfiler::BbvProfiler()
+{
+    fp = NULL;
+    interval = count = 0;
+    leader = nextpc = len = 0;
+    delay = split = 0;
+    size = BBV_TABLE;
+    nentry = 0;
+    table = new bbvent_t[size];
+    memset(table, 0, sizeof(bbvent_t) * size);
+}
+
+/**********************************************************************/
+BbvProfiler::~BbvProfiler()
+{
+    if (fp) {
+        // the last interval is written even if it is a short one
+        endblock();
+        if (count)
+            dump();
+        fclose(fp);
+    }
+    DELETE_ARRAY(table);
+}
+
+/**********************************************************************/
+int BbvProfiler::open(const char *filename, ullint interval)
+{
+    if ((fp = fopen(filename, "w")) == NULL) {
+        fprintf(stderr, "## can't open bbv file: %s\n", filename);
+        return 1;
+    }
+    this->interval = interval;
+    fprintf(fp, "# interval %llu\n", interval);
+    return 0;
+}
+
+/**********************************************************************/
+bbvent_t *BbvProfiler::lookup(uint032_t pc)
+{
+    uint032_t i = (pc >> 2) & (size - 1);
+    while ((table[i].id) && (table[i].pc != pc))
+        i = (i + 1) & (size - 1);
+    return &table[i];
+}
+
+/**********************************************************************/
+void BbvProfiler::grow()
+{
+    // the table is kept at most half full
+    bbvent_t *old = table;
+    uint032_t oldsize = size;
+    size *= 2;
+    table = new bbvent_t[size];
+    memset(table, 0, sizeof(bbvent_t) * size);
+    for (uint032_t i = 0; i < oldsize; i++)
+        if (old[i].id)
+            *lookup(old[i].pc) = old[i];
+    DELETE_ARRAY(old);
+}
+
+/**********************************************************************/
+void BbvProfiler::endblock()
+{
+    if (!len)
+        return;
+    bbvent_t *e = lookup(leader);
+    if (!e->id) {
+        e->pc = leader;
+        e->id = ++nentry;
+        if (nentry * 2 > size) {
+            grow();
+            e = lookup(leader);
+        }
+    }
+    e->count += len;
+    len = 0;
+}
+
+/**********************************************************************/
+void BbvProfiler::dump()
+{
+    fprintf(fp, "T");
+    for (uint032_t i = 0; i < size; i++)
+        if (table[i].count) {
+            fprintf(fp, ":%u:%llu ", table[i].id, table[i].count);
+            table[i].count = 0;
+        }
+    fprintf(fp, "\n");
+    count = 0;
+}
+
+/**********************************************************************/
+void BbvProfiler::step(uint032_t pc, uint attr)
+{
+    if ((split) || (pc != nextpc)) {
+        endblock();
+        leader = pc;
+    }
+    len++;
+    nextpc = pc + 4;
+    split = (delay) || (attr & BRANCH_ERET);
+    delay = (attr & (BRANCH | BRANCH_LIKELY)) ? 1 : 0;
+
+    // a block cut by the end of an interval goes on in the next one
+    if (++count >= interval) {
+        endblock();
+        dump();
+    }
+}
+
+/**********************************************************************/
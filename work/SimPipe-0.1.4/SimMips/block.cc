@@ -0,0 +1,62 @@
+/**********************************************************************
+ * SimMips: Simple Computer Simulator of MIPS    Arch Lab. TOKYO TECH *
+ **********************************************************************/
+#include "define.h"
+
+/**********************************************************************/
+MipsBlockCache::MipsBlockCache(MipsInstCache *ic)
+{
+    this->ic = ic;
+    block = new MipsBlock[BC_BLOCK];
+    hash = new MipsBlock *[BC_HASH];
+    arena = new MipsInst[BC_ARENA];
+    flush();
+}
+
+/**********************************************************************/
+MipsBlockCache::~MipsBlockCache()
+{
+    DELETE_ARRAY(block);
+    DELETE_ARRAY(hash);
+    DELETE_ARRAY(arena);
+}
+
+/**********************************************************************/
+void MipsBlockCache::flush()
+{
+    // blocks are dropped all at once, which also kills every chain
+    for (int i = 0; i < BC_HASH; i++)
+        hash[i] = NULL;
+    nblock = 0;
+    narena = 0;
+    generation = ic->generation;
+}
+
+/**********************************************************************/
+MipsInst *MipsBlockCache::reserve()
+{
+    if ((nblock >= BC_BLOCK) || (narena + BC_MAXLEN > BC_ARENA))
+        return NULL;
+    return &arena[narena];
+}
+
+/**********************************************************************/
+MipsBlock *MipsBlockCache::insert(uint064_t paddr, uint032_t pc, int n)
+{
+    MipsBlock *b = &block[nblock++];
+    MipsBlock **head = &hash[(paddr >> 2) & (BC_HASH - 1)];
+    b->paddr = paddr;
+    b->pc = pc;
+    b->ninst = n;
+    b->inst = &arena[narena];
+    b->next[0] = b->next[1] = NULL;
+    b->nextvictim = 0;
+    b->compiled = 0;
+    b->code = NULL;
+    b->hnext = *head;
+    *head = b;
+    narena += n;
+    return b;
+}
+
+/**********************************************************************/
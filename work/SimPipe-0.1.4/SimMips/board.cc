@@ -1,622 +1,1011 @@
-/**********************************************************************
- * SimMips: Simple Computer Simulator of MIPS    Arch Lab. TOKYO TECH *
- **********************************************************************/
-#include "define.h"
-
-#define MEM_HEADER "SimMips_Machine_Setting"
-
-enum {
-    SR_DEF       = 0x10000000,
-    PAGEMASK_DEF = 0x00001fff,
-    PRID_DEF     = 0x00018001,
-    CONFIG_DEF   = 0x80000082,
-    CONFIG1_DEF  = 0x1ed96c80,
-
-    RUNNING = 0,
-    HALT_CYCLE = 1,
-    HALT_MIPS = 2,
-    HALT_INT = 3,
-
-    HEAD_SIZE = 128,
-};
-
-/**********************************************************************/
-volatile sig_atomic_t recieve_int = 0;
-
-void sigint_handler(int signum)
-{
-    recieve_int = 1;
-}
-
-/**********************************************************************/
-ttyControl::ttyControl()
-{
-    struct termios newterm;
-    int newfflg;
-
-    tcgetattr(STDIN_FILENO, &oldterm);
-    oldfflg = fcntl(STDIN_FILENO, F_GETFL);
-
-    if ((oldterm.c_lflag & (ICANON | ECHO)) == 0) {
-        valid = 0;
-        return;
-    }
-
-    newterm = oldterm;
-    newterm.c_lflag &= ~(ICANON | ECHO);
-    newterm.c_cc[VMIN] = 0;
-    newterm.c_cc[VTIME] = 0;
-    newfflg = oldfflg | O_NONBLOCK;
-
-    tcsetattr(STDIN_FILENO, TCSANOW, &newterm);
-    fcntl(STDIN_FILENO, F_SETFL, newfflg);
-    valid = 1;
-}
-
-/**********************************************************************/
-ttyControl::~ttyControl()
-{
-    if (valid) {
-        tcsetattr(STDIN_FILENO, TCSANOW, &oldterm);
-        fcntl(STDIN_FILENO, F_SETFL, oldfflg);
-    }
-}
-
-/**********************************************************************/
-Board::Board()
-{
-    debug_mode = multicycle = imix_mode = use_cp0 = use_ttyc = 0;
-    maxcycle = MAX_CYCLE_DEF;
-    binfile = memfile = NULL;
-    ttyc = NULL;
-    mmap = NULL;
-}
-
-/**********************************************************************/
-Board::~Board()
-{
-    DELETE(ttyc);
-    DELETE(chip);
-    DELETE(mmap);
-}
-
-/**********************************************************************/
-void Board::usage()
-{
-    char usagemessage[] = "\
-  -e[num][kmg]: stop simulation after num cycles executed\n\
-  -d[level]: debug mode\n\
-  -i: put instruction mix after simulation\n\
-  -m: use multi-cycle execution model\n\
-  -M [filename]: specify machine setting file\n\
-\n";
-
-    printf("Usage: simmips [-options] object_file_name\n");
-    printf("%s", usagemessage);
-}
-
-/**********************************************************************/
-ullint Board::atoi_postfix(const char *nptr)
-{
-    char *endptr;
-    ullint result = strtoll(nptr, &endptr, 10);
-    if ((*endptr == 'k') || (*endptr == 'K'))
-        result *= 1000;
-    else if ((*endptr == 'm') || (*endptr == 'M'))
-        result *= 1000000;
-    else if ((*endptr == 'g') || (*endptr == 'G'))
-        result *= 1000000000;
-    return result;
-}
-
-/**********************************************************************/
-void Board::checkarg(int argc, char **argv)
-{
-    int bin_index = -1;
-    int num;
-    char *opt;
-
-    for (int i = 1; (opt = argv[i]) != NULL; i++) {
-        if (opt[0] != '-') {
-            if (bin_index != -1) {
-                fprintf(stderr, "## multiple binary files(%s, %s)\n",
-                        argv[bin_index], opt);
-                usage();
-                return;
-            }
-            bin_index = i;
-            continue;
-        }
-        switch (opt[1]) {
-        case 'd':
-            num = atoi(&opt[2]);
-            if (num > MAX_DEBUG_MODE) {
-                fprintf(stderr, "## debug mode %d not available\n", num);
-                return;
-            }
-            debug_mode = num;
-            break;
-        case 'e':
-            maxcycle = atoi_postfix(&opt[2]);
-            if (!maxcycle)
-                maxcycle = MAX_CYCLE_DEF;
-            break;
-        case 'i':
-            imix_mode = 1;
-            break;
-        case 'm':
-            multicycle = 1;
-            break;
-        case 'M':
-            if (memfile) {
-                fprintf(stderr, "## multiple -M options\n");
-                return;
-            }
-            if ((memfile = argv[++i]) == NULL) {
-                fprintf(stderr, "## -M option: no file specified\n");
-                return;
-            }
-            break;
-        default:
-            fprintf(stderr, "## -%c: invalid option\n", opt[1]);
-            usage();
-            return;
-        }
-    }
-    if (bin_index == -1) {
-        usage();
-        return;
-    }
-
-    if (debug_mode)
-        printf("## debug mode %d.\n", debug_mode);
-
-    binfile = argv[bin_index];
-}
-
-/**********************************************************************/
-int Board::loadrawfile(char *filename, uint032_t addr)
-{
-    FILE *fp;
-    uint008_t temp;
-
-    if ((fp = fopen(filename, "rb")) == NULL) {
-        fprintf(stderr, "## can't open file: %s\n", filename);
-        return 1;
-    }
-    while (fread(&temp, sizeof(temp), 1, fp)) {
-        chip->mc->enqueue(addr, 1, &temp);
-        chip->mc->step();
-        addr++;
-    }
-    if (!feof(fp)) {
-        fprintf(stderr, "## can't load file: %s\n", filename);
-        return 1;
-    }
-    fclose(fp);
-    return 0;
-}
-
-/**********************************************************************/
-char* Board::getlinehead(char *dest, FILE *fp)
-{
-    memset(dest, '\0', HEAD_SIZE + 1);
-    char *result = fgets(dest, HEAD_SIZE, fp);
-    int len = strlen(dest);
-    if (dest[len - 1] != '\n') {
-        if (dest[len - 1] == '\r')
-            dest[len - 1] = '\0';
-        char poi[HEAD_SIZE];
-        do
-            if (fgets(poi, HEAD_SIZE, fp) == NULL)
-                break;
-        while (poi[strlen(poi) - 1] != '\n');
-    } else {
-        dest[len - 1] = '\0';
-        if (dest[len - 2] == '\r')
-            dest[len - 2] = '\0';
-    }
-    return result;
-}
-
-/**********************************************************************/
-FILE *Board::openmemfile()
-{
-    FILE *fp;
-    char line[HEAD_SIZE + 1];
-    line[HEAD_SIZE] = '\0';
-
-    if ((fp = fopen(memfile, "r")) == NULL) {
-        fprintf(stderr, "## can't open file: %s\n", memfile);
-        return NULL;
-    }
-    getlinehead(line, fp);
-    if (strncmp(line, MEM_HEADER, strlen(MEM_HEADER)) != 0) {
-        fprintf(stderr, "## not a machine setting file: %s\n", memfile);
-        fclose(fp);
-        return NULL;
-    }
-    return fp;
-}
-
-/**********************************************************************/
-void Board::setdefaultmap()
-{
-    mmap = new MemoryMap();
-    mmap->addr = 0;
-    mmap->size = MEM_SIZE_DEF;
-    mmap->dev = new MainMemory(MEM_SIZE_DEF);
-}
-
-/**********************************************************************/
-int Board::setmemorymap()
-{
-    FILE *fp;    
-    char line[HEAD_SIZE + 1];
-    uint032_t addr, size;
-    int linecnt = 1;
-    char *endptr;
-    MemoryMap *now = NULL;
-    line[HEAD_SIZE] = '\0';
-
-    if (!memfile) {
-        setdefaultmap();
-        return 0;
-    }
-    if ((fp = openmemfile()) == NULL)
-        return 1;
-
-    while (getlinehead(line, fp) != NULL) {
-        linecnt++;
-        if (strncmp(line, "@map", 4))
-            continue;
-
-        addr = strtoul(&line[5], &endptr, 16);
-        size = strtoul(&endptr[1], &endptr, 16);
-        if (!size) {
-            fprintf(stderr, "## %s:%d: invalid syntax. skip.\n",
-                    memfile, linecnt);
-            continue;
-        }
-        if (!now)
-            now = (mmap = new MemoryMap());
-        else
-            now = (now->next = new MemoryMap());
-        now->addr = addr;
-        now->size = size;
-
-        if (strcmp(&endptr[1], "MAIN_MEMORY") == 0) {
-            now->dev = new MainMemory(size);
-        } else if (strcmp(&endptr[1], "ISA_IO") == 0) {
-            now->dev = new IsaIO();
-            use_cp0 = use_ttyc = 1;
-        } else if (strcmp(&endptr[1], "ISA_BUS") == 0) {
-            now->dev = new MMDevice();
-        } else if (strcmp(&endptr[1], "MIERU_IO") == 0) {
-            now->dev = new MieruIO();
-            use_ttyc = 1;
-        }
-    }
-    if (!now)
-        setdefaultmap();
-    fclose(fp);
-    return 0;
-}
-
-/**********************************************************************/
-int Board::setinitialdata()
-{
-    FILE *fp;
-    char line[HEAD_SIZE + 1];
-    int linecnt = 1, regnum;
-    uint032_t addr, regval;
-    char *endptr;
-    line[HEAD_SIZE] = '\0';
-
-    if (!memfile)
-        return 0;
-
-    if ((fp = openmemfile()) == NULL)
-        return 1;
-
-    while (getlinehead(line, fp) != NULL) {
-        linecnt++;
-        if (line[0] != '@')
-            continue;
-
-        if (strncmp(&line[1], "reg", 3) == 0) {
-            regnum = strtol(&line[6], &endptr, 10);
-            if (!regnum)
-                for (int i = 1; i < NREG + 1; i++)
-                    if (strncmp(&line[6], regname[i], 
-                                strlen(regname[i])) == 0) {
-                        regnum = i;
-                        endptr = &line[6 + strlen(regname[i])];
-                        break;
-                    }
-            if (endptr[0] != '=') {
-                fprintf(stderr, "## %s:%d: invalid syntax. skip.\n",
-                        memfile, linecnt);
-                continue;
-            } else {
-                regval = strtoul(&endptr[1], NULL, 0);
-            }   
-            if ((!regnum) && (regnum >= NREG + 1)) {
-                fprintf(stderr, "## %s:%d: invalid register. skip.\n",
-                        memfile, linecnt);
-            } else if (regnum != NREG) {
-                chip->mips->as->r[regnum] = regval;
-            } else {
-                chip->mips->as->pc = regval;
-            }
-        } else if (strncmp(&line[1], "mem", 3) == 0) {
-            addr = strtoul(&line[5], &endptr, 16);
-            loadrawfile(&endptr[1], addr);
-        } else if (strncmp(&line[1], "map", 3) != 0) {
-            fprintf(stderr, "## %s:%d: unknown command. skip.\n",
-                    memfile, linecnt);
-        }
-    }
-    fclose(fp);
-    return 0;
-}
-
-/**********************************************************************/
-ullint Board::gettime()
-{
-    static ullint start = 0;
-    ullint tm;
-    struct timeval tv;
-
-    gettimeofday(&tv, NULL);
-    tm = tv.tv_sec * 1000000ull + tv.tv_usec;
-    if (start == 0)
-        start = tm;
-    return tm - start;
-}
-
-/**********************************************************************/
-int Board::siminit(char *arg)
-{
-    if (arg == NULL)
-        return 1;
-    if (arg[0] == '\0')
-        return 1;
-
-    int num, argc = 0;
-    int arglen = strlen(arg);
-    char *head = new char[arglen + 1];
-    memset(head, 0, arglen + 1);
-    char *temp = new char[arglen + 1];
-    strcpy(temp, arg);
-    char flag = ' ';
-
-    for (int i = 0; i < arglen; i++) {
-        if ((temp[i] == '"') || (temp[i] == '\'')) {
-            if (flag == temp[i]) {
-                temp[i] = '\0';
-                flag = ' ';
-            } else if ((flag != '"') && (flag != '\'')) {
-                head[i + 1] = 1;
-                argc++;
-                flag = temp[i];
-            }
-        } else if ((temp[i] == ' ') && (flag == '\0')) {
-            temp[i] = '\0';
-            flag = ' ';
-        } else if ((temp[i] != ' ') && (flag == ' ')) {
-            head[i] = 1;
-            argc++;
-            flag = '\0';
-        }
-    }
-    if ((flag == '"') || (flag == '\'')) {
-        fprintf(stderr, "## checkarg(): syntax error\n");
-        return 1;
-    }
-    char **argv = new char*[argc + 2];
-    num = 1;
-    for (int i = 0; i < arglen; i++) {
-        if (head[i]) {
-            argv[num] = &temp[i];
-            num++;
-        }
-    }
-    argv[0] = argv[argc + 1] = NULL;
-
-    int ret = siminit(argc, argv);
-
-    DELETE_ARRAY(head);
-    DELETE_ARRAY(temp);
-    DELETE_ARRAY(argv);
-    return ret;
-}
-
-/**********************************************************************/
-int Board::siminit(int argc, char **argv)
-{
-    struct sigaction sa;
-
-    checkarg(argc, argv);
-    if (!binfile)
-        return 1;
-    if (setmemorymap())
-        return 1;
-    chip = new Chip(this, use_cp0, multicycle);
-
-    // load ELF image
-    SimLoader *ld = new SimLoader();
-    if (ld->loadfile(binfile))
-        return 1;
-    if ((ld->archtype != EM_MIPS) ||
-        (ld->filetype != ET_EXEC)) { // || (ld->dynamic)) {
-        printf("## ERROR: inproper binary: %s\n", binfile);
-        return 1;
-    }
-
-    // set registers' default value
-    chip->mips->as->pc = ld->entry;
-    chip->mips->as->r[REG_SP] = ((ld->stackptr) ? ld->stackptr :
-                                 MEM_SIZE_DEF - 0x100);
-    if (!use_cp0)
-        chip->mips->as->r[REG_T9] = chip->mips->as->pc;
-    for (int i = 0; i < ld->symtabnum; i++)
-        if (strcmp(ld->symtab[i].name, "_gp") == 0) {
-            chip->mips->as->r[REG_GP] = ld->symtab[i].addr;
-            break;
-        }
-    if (use_cp0) {
-        chip->cp0->writereg(CP0_SR______, SR_DEF);
-        chip->cp0->writereg(CP0_PAGEMASK, PAGEMASK_DEF);
-        chip->cp0->writereg(CP0_PRID____, PRID_DEF);
-        chip->cp0->writereg(CP0_CONFIG__, CONFIG_DEF);
-        chip->cp0->writereg(CP0_CONFIG1_, CONFIG1_DEF);
-    }
-
-    if (setinitialdata())
-        return 1;
-
-    // write ELF image to memory
-    if (use_cp0) {
-        for (int i = 0; i < ld->memtabnum; i++) {
-            if ((ld->memtab[i].addr <  KSEG0_MIN) ||
-                (ld->memtab[i].addr >= KSEG2_MIN)) {
-                printf("## ERROR: load to unmapped segment: 0x%08x\n",
-                       ld->memtab[i].addr);
-                return 1;
-            } else {
-                ld->memtab[i].addr &= UNMAP_MASK;
-            }
-        }
-    }
-    for (int i = 0; i < ld->memtabnum; i++) {
-        chip->mc->enqueue(ld->memtab[i].addr, 1, &ld->memtab[i].data);
-        chip->mc->step();
-    }
-    DELETE(ld);
-
-    // set up console and signal
-    if (use_ttyc)
-        ttyc = new ttyControl();
-    sa.sa_handler = sigint_handler;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = 0;
-    sigaction(SIGINT, &sa, NULL);
-
-    for (MemoryMap *temp = mmap; temp != NULL; temp = temp->next)
-        temp->dev->init(this);
-
-    // now, the chip is ready for execution
-    chip->maxcycle = maxcycle;
-    chip->mips->state = CPU_START;
-    chip->ready = 1;
-    return 0;
-}
-
-/**********************************************************************/
-void Board::exec()
-{
-    gettime();
-    if (multicycle) {
-        while (chip->getstate() == RUNNING)
-            chip->step_multi();
-    } else {
-        while (chip->getstate() == RUNNING)
-            chip->step_funct();
-    }
-    printresult();
-}
-
-/**********************************************************************/
-void Board::printresult() {
-    double simtime = (double) gettime() / 1000000.0;
-
-    for (MemoryMap *temp = mmap; temp != NULL; temp = temp->next)
-        temp->dev->fini();
-
-    if      (chip->getstate() == HALT_CYCLE)
-        printf("\n## cycle count reaches the limit\n");
-    else if (chip->getstate() == HALT_MIPS)
-        printf("\n## cpu stopped\n");
-    else // (recieve_int)
-        printf("\n## interrupt\n");
-    printf("## cycle count: %llu\n", chip->cycle);
-    printf("## inst count: %llu\n", chip->mips->ss->inst_count);
-    printf("## simulation time: %8.3f\n", simtime);
-    printf("## mips: %4.3f\n\n", 
-           chip->mips->ss->inst_count / (simtime * 1000000.0));
-
-    if (debug_mode == DEB_RESULT) {
-        chip->mips->as->print();
-        if (chip->cp0)
-            chip->cp0->print();
-        chip->mc->print();
-    }
-    if (imix_mode)
-        chip->mips->ss->print();
-}
-
-/**********************************************************************/
-Chip::Chip(Board *board, int use_cp0, int multi)
-{
-    cycle = 0;
-    ready = 0;
-
-    this->board = board;
-    this->mmap = board->mmap;
-    if (use_cp0)
-        cp0 = new MipsCp0(board, this, (multi) ? 3 : 1);
-    else
-        cp0 = NULL;
-    mc = new MemoryController(mmap,
-                              (multi) ? MC_BUFFERMODE : MC_THROUGHMODE);
-    mips = new Mips(board, this);
-}
-
-/**********************************************************************/
-Chip::~Chip()
-{
-    DELETE(mips);
-    DELETE(mc);
-    DELETE(cp0);
-}
-
-/**********************************************************************/
-int Chip::step_funct()
-{
-    cycle++;
-    int ret = mips->step_funct();
-    if (cp0)
-        cp0->step();
-    for (MemoryMap *temp = mmap; temp != NULL; temp = temp->next)
-        temp->dev->step();
-    return ret;
-}
-
-/**********************************************************************/
-int Chip::step_multi()
-{
-    cycle++;
-    int ret = mips->step_multi();
-    if (cp0)
-        cp0->step();
-    for (MemoryMap *temp = mmap; temp != NULL; temp = temp->next)
-        temp->dev->step();
-    mc->step();
-    return ret;
-}
-
-/**********************************************************************/
-int Chip::getstate()
-{
-    if (cycle >= maxcycle)
-        return HALT_CYCLE;
-    else if (!mips->running())
-        return HALT_MIPS;
-    else if (recieve_int)
-        return HALT_INT;
-    else
-        return RUNNING;
-}
-
-/**********************************************************************/
+/**********************************************************************
+ * SimMips: Simple Computer Simulator of MIPS    Arch Lab. TOKYO TECH *
+ **********************************************************************/
+#include "define.h"
+#include <sys/mman.h>
+
+#define MEM_HEADER "SimMips_Machine_Setting"
+
+enum {
+    SR_DEF       = 0x10000000,
+    PAGEMASK_DEF = 0x00001fff,
+    PRID_DEF     = 0x00018001,
+    CONFIG_DEF   = 0x80000082,
+    CONFIG1_DEF  = 0x1ed96c80,
+
+    RUNNING = 0,
+    HALT_CYCLE = 1,
+    HALT_MIPS = 2,
+    HALT_INT = 3,
+
+    HEAD_SIZE = 128,
+};
+
+/**********************************************************************/
+volatile sig_atomic_t recieve_int = 0;
+
+void sigint_handler(int signum)
+{
+    recieve_int = 1;
+}
+
+/**********************************************************************/
+ttyControl::ttyControl()
+{
+    struct termios newterm;
+    int newfflg;
+
+    tcgetattr(STDIN_FILENO, &oldterm);
+    oldfflg = fcntl(STDIN_FILENO, F_GETFL);
+
+    if ((oldterm.c_lflag & (ICANON | ECHO)) == 0) {
+        valid = 0;
+        return;
+    }
+
+    newterm = oldterm;
+    newterm.c_lflag &= ~(ICANON | ECHO);
+    newterm.c_cc[VMIN] = 0;
+    newterm.c_cc[VTIME] = 0;
+    newfflg = oldfflg | O_NONBLOCK;
+
+    tcsetattr(STDIN_FILENO, TCSANOW, &newterm);
+    fcntl(STDIN_FILENO, F_SETFL, newfflg);
+    valid = 1;
+}
+
+/**********************************************************************/
+ttyControl::~ttyControl()
+{
+    if (valid) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &oldterm);
+        fcntl(STDIN_FILENO, F_SETFL, oldfflg);
+    }
+}
+
+/**********************************************************************/
+Board::Board()
+{
+    debug_mode = multicycle = imix_mode = use_cp0 = use_ttyc = 0;
+    flat_mem = demand_mem = 0;
+    engine = ENGINE_INTERP;
+    maxcycle = MAX_CYCLE_DEF;
+    ckptcycle = 0;
+    bbvinterval = BBV_INTERVAL_DEF;
+    binfile = memfile = ckptfile = resumefile = bbvfile = tracefile = NULL;
+    ttyc = NULL;
+    images = NULL;
+    mmap = NULL;
+    aotimage = NULL;
+}
+
+/**********************************************************************/
+Board::~Board()
+{
+    DELETE(ttyc);
+    DELETE(chip);
+    DELETE(mmap);
+    while (images) {
+        imagemap_t *next = images->next;
+        munmap(images->addr, images->size);
+        delete images;
+        images = next;
+    }
+}
+
+/**********************************************************************/
+void Board::usage()
+{
+    char usagemessage[] = "\
+  -e[num][kmg]: stop simulation after num cycles executed\n\
+  -d[level]: debug mode\n\
+  -i: put instruction mix after simulation\n\
+  -m: use multi-cycle execution model\n\
+  -t: use threaded-code execution engine\n\
+  -b: use basic-block execution engine\n\
+  -j: use x86-64 dynamic translator (without cp0, -b otherwise)\n\
+  -F: map main memory as one flat region\n\
+  -L: page main memory in from the image files on first touch\n\
+  -M [filename]: specify machine setting file\n\
+  -c[num][kmg] [filename]: save a checkpoint after num cycles, or at\n\
+                           ori $zero,$zero,0xc0de if num is omitted\n\
+  -r [filename]: resume from a checkpoint\n\
+  -v[num][kmg] [filename]: write basic block vectors of num insts\n\
+                           (10m if omitted), inst by inst\n\
+  -T [filename]: write a binary trace of the insts run, for SimPipe\n\
+\n";
+
+    printf("Usage: simmips [-options] object_file_name\n");
+    printf("%s", usagemessage);
+}
+
+/**********************************************************************/
+ullint Board::atoi_postfix(const char *nptr)
+{
+    char *endptr;
+    ullint result = strtoll(nptr, &endptr, 10);
+    if ((*endptr == 'k') || (*endptr == 'K'))
+        result *= 1000;
+    else if ((*endptr == 'm') || (*endptr == 'M'))
+        result *= 1000000;
+    else if ((*endptr == 'g') || (*endptr == 'G'))
+        result *= 1000000000;
+    return result;
+}
+
+/**********************************************************************/
+void Board::checkarg(int argc, char **argv)
+{
+    int bin_index = -1;
+    int num;
+    char *opt;
+
+    for (int i = 1; (opt = argv[i]) != NULL; i++) {
+        if (opt[0] != '-') {
+            if (bin_index != -1) {
+                fprintf(stderr, "## multiple binary files(%s, %s)\n",
+                        argv[bin_index], opt);
+                usage();
+                return;
+            }
+            bin_index = i;
+            continue;
+        }
+        switch (opt[1]) {
+        case 'd':
+            num = atoi(&opt[2]);
+            if (num > MAX_DEBUG_MODE) {
+                fprintf(stderr, "## debug mode %d not available\n", num);
+                return;
+            }
+            debug_mode = num;
+            break;
+        case 'e':
+            maxcycle = atoi_postfix(&opt[2]);
+            if (!maxcycle)
+                maxcycle = MAX_CYCLE_DEF;
+            break;
+        case 'i':
+            imix_mode = 1;
+            break;
+        case 'm':
+            multicycle = 1;
+            break;
+        case 't':
+            engine = ENGINE_THREAD;
+            break;
+        case 'b':
+            engine = ENGINE_BLOCK;
+            break;
+        case 'j':
+            engine = ENGINE_JIT;
+            break;
+        case 'F':
+            flat_mem = 1;
+            break;
+        case 'L':
+            demand_mem = 1;
+            break;
+        case 'M':
+            if (memfile) {
+                fprintf(stderr, "## multiple -M options\n");
+                return;
+            }
+            if ((memfile = argv[++i]) == NULL) {
+                fprintf(stderr, "## -M option: no file specified\n");
+                return;
+            }
+            break;
+        case 'c':
+            ckptcycle = atoi_postfix(&opt[2]);
+            if ((ckptfile = argv[++i]) == NULL) {
+                fprintf(stderr, "## -c option: no file specified\n");
+                return;
+            }
+            break;
+        case 'r':
+            if ((resumefile = argv[++i]) == NULL) {
+                fprintf(stderr, "## -r option: no file specified\n");
+                return;
+            }
+            break;
+        case 'v':
+            bbvinterval = atoi_postfix(&opt[2]);
+            if (!bbvinterval)
+                bbvinterval = BBV_INTERVAL_DEF;
+            if ((bbvfile = argv[++i]) == NULL) {
+                fprintf(stderr, "## -v option: no file specified\n");
+                return;
+            }
+            break;
+        case 'T':
+            if ((tracefile = argv[++i]) == NULL) {
+                fprintf(stderr, "## -T option: no file specified\n");
+                return;
+            }
+            break;
+        default:
+            fprintf(stderr, "## -%c: invalid option\n", opt[1]);
+            usage();
+            return;
+        }
+    }
+    if (bin_index == -1) {
+        usage();
+        return;
+    }
+
+    if (debug_mode)
+        printf("## debug mode %d.\n", debug_mode);
+
+    binfile = argv[bin_index];
+}
+
+/**********************************************************************/
+int Board::loadrawfile(char *filename, uint032_t addr)
+{
+    int fd;
+    struct stat sb;
+    void *file = NULL;
+
+    if ((fd = open(filename, O_RDONLY)) == -1) {
+        fprintf(stderr, "## can't open file: %s\n", filename);
+        return 1;
+    }
+    if (fstat(fd, &sb) == -1)
+        file = MAP_FAILED;
+    else if (sb.st_size)
+        file = ::mmap(NULL, sb.st_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED) {
+        fprintf(stderr, "## can't load file: %s\n", filename);
+        return 1;
+    }
+
+    // the image is copied into main memory a page at a time
+    writeimage(addr, (uint008_t *) file, (uint032_t) sb.st_size);
+    if ((file) && (demand_mem))
+        keepimage(file, sb.st_size);
+    else if (file)
+        munmap(file, sb.st_size);
+    return 0;
+}
+
+/**********************************************************************/
+void Board::writeimage(uint032_t addr, const uint008_t *data, uint032_t size)
+{
+    // copied (or zero-filled if no data) straight into the host page,
+    // a device without one is written through mc a byte at a time.
+    // with -L, a whole page of a file mapping is used as it is, so that
+    // it is read in on first touch and copied by the host on first write
+    static const uint008_t zero = 0;
+    while (size > 0) {
+        MemoryMap *temp;
+        for (temp = mmap; temp != NULL; temp = temp->next)
+            if (addr - temp->addr < temp->size)
+                break;
+        uint032_t n = PAGE_SIZE - addr % PAGE_SIZE;
+        uint008_t *page = NULL;
+        if (temp) {
+            uint032_t off = addr - temp->addr;
+            n = PAGE_SIZE - off % PAGE_SIZE;
+            if (n > temp->size - off)
+                n = temp->size - off;
+            if ((demand_mem) && (data) && (n == PAGE_SIZE) &&
+                (size >= PAGE_SIZE) &&
+                ((uintptr_t) data % PAGE_SIZE == 0) &&
+                (temp->dev->setpageentry(off, (uint032_t *) data))) {
+                addr += n;
+                size -= n;
+                data += n;
+                continue;
+            }
+            page = temp->dev->gethostpage(off);
+            if (page)
+                page += off % PAGE_SIZE;
+        }
+        if (n > size)
+            n = size;
+        if (page) {
+            if (data)
+                memcpy(page, data, n);
+            else
+                memset(page, 0, n);
+        } else {
+            for (uint032_t i = 0; i < n; i++) {
+                chip->mc->enqueue(addr + i, 1,
+                                  (void *) ((data) ? &data[i] : &zero));
+                chip->mc->step();
+            }
+        }
+        addr += n;
+        size -= n;
+        if (data)
+            data += n;
+    }
+}
+
+/**********************************************************************/
+void Board::keepimage(void *addr, size_t size)
+{
+    imagemap_t *map = new imagemap_t;
+    map->addr = addr;
+    map->size = size;
+    map->next = images;
+    images = map;
+}
+
+/**********************************************************************/
+char* Board::getlinehead(char *dest, FILE *fp)
+{
+    memset(dest, '\0', HEAD_SIZE + 1);
+    char *result = fgets(dest, HEAD_SIZE, fp);
+    int len = strlen(dest);
+    if (dest[len - 1] != '\n') {
+        if (dest[len - 1] == '\r')
+            dest[len - 1] = '\0';
+        char poi[HEAD_SIZE];
+        do
+            if (fgets(poi, HEAD_SIZE, fp) == NULL)
+                break;
+        while (poi[strlen(poi) - 1] != '\n');
+    } else {
+        dest[len - 1] = '\0';
+        if (dest[len - 2] == '\r')
+            dest[len - 2] = '\0';
+    }
+    return result;
+}
+
+/**********************************************************************/
+FILE *Board::openmemfile()
+{
+    FILE *fp;
+    char line[HEAD_SIZE + 1];
+    line[HEAD_SIZE] = '\0';
+
+    if ((fp = fopen(memfile, "r")) == NULL) {
+        fprintf(stderr, "## can't open file: %s\n", memfile);
+        return NULL;
+    }
+    getlinehead(line, fp);
+    if (strncmp(line, MEM_HEADER, strlen(MEM_HEADER)) != 0) {
+        fprintf(stderr, "## not a machine setting file: %s\n", memfile);
+        fclose(fp);
+        return NULL;
+    }
+    return fp;
+}
+
+/**********************************************************************/
+void Board::setdefaultmap()
+{
+    mmap = new MemoryMap();
+    mmap->addr = 0;
+    mmap->size = MEM_SIZE_DEF;
+    mmap->dev = new MainMemory(MEM_SIZE_DEF, flat_mem);
+}
+
+/**********************************************************************/
+int Board::setmemorymap()
+{
+    FILE *fp;    
+    char line[HEAD_SIZE + 1];
+    uint032_t addr, size;
+    int linecnt = 1;
+    char *endptr;
+    MemoryMap *now = NULL;
+    line[HEAD_SIZE] = '\0';
+
+    if (!memfile) {
+        setdefaultmap();
+        return 0;
+    }
+    if ((fp = openmemfile()) == NULL)
+        return 1;
+
+    while (getlinehead(line, fp) != NULL) {
+        linecnt++;
+        if (strncmp(line, "@map", 4))
+            continue;
+
+        addr = strtoul(&line[5], &endptr, 16);
+        size = strtoul(&endptr[1], &endptr, 16);
+        if (!size) {
+            fprintf(stderr, "## %s:%d: invalid syntax. skip.\n",
+                    memfile, linecnt);
+            continue;
+        }
+        if (!now)
+            now = (mmap = new MemoryMap());
+        else
+            now = (now->next = new MemoryMap());
+        now->addr = addr;
+        now->size = size;
+
+        if (strcmp(&endptr[1], "MAIN_MEMORY") == 0) {
+            now->dev = new MainMemory(size, flat_mem);
+        } else if (strcmp(&endptr[1], "ISA_IO") == 0) {
+            now->dev = new IsaIO();
+            use_cp0 = use_ttyc = 1;
+        } else if (strcmp(&endptr[1], "ISA_BUS") == 0) {
+            now->dev = new MMDevice();
+        } else if (strcmp(&endptr[1], "MIERU_IO") == 0) {
+            now->dev = new MieruIO();
+            use_ttyc = 1;
+        }
+    }
+    if (!now)
+        setdefaultmap();
+    fclose(fp);
+    return 0;
+}
+
+/**********************************************************************/
+int Board::setinitialdata()
+{
+    FILE *fp;
+    char line[HEAD_SIZE + 1];
+    int linecnt = 1, regnum;
+    uint032_t addr, regval;
+    char *endptr;
+    line[HEAD_SIZE] = '\0';
+
+    if (!memfile)
+        return 0;
+
+    if ((fp = openmemfile()) == NULL)
+        return 1;
+
+    while (getlinehead(line, fp) != NULL) {
+        linecnt++;
+        if (line[0] != '@')
+            continue;
+
+        if (strncmp(&line[1], "reg", 3) == 0) {
+            regnum = strtol(&line[6], &endptr, 10);
+            if (!regnum)
+                for (int i = 1; i < NREG + 1; i++)
+                    if (strncmp(&line[6], regname[i], 
+                                strlen(regname[i])) == 0) {
+                        regnum = i;
+                        endptr = &line[6 + strlen(regname[i])];
+                        break;
+                    }
+            if (endptr[0] != '=') {
+                fprintf(stderr, "## %s:%d: invalid syntax. skip.\n",
+                        memfile, linecnt);
+                continue;
+            } else {
+                regval = strtoul(&endptr[1], NULL, 0);
+            }   
+            if ((!regnum) && (regnum >= NREG + 1)) {
+                fprintf(stderr, "## %s:%d: invalid register. skip.\n",
+                        memfile, linecnt);
+            } else if (regnum != NREG) {
+                chip->mips->as->r[regnum] = regval;
+            } else {
+                chip->mips->as->pc = regval;
+            }
+        } else if (strncmp(&line[1], "mem", 3) == 0) {
+            addr = strtoul(&line[5], &endptr, 16);
+            loadrawfile(&endptr[1], addr);
+        } else if (strncmp(&line[1], "map", 3) != 0) {
+            fprintf(stderr, "## %s:%d: unknown command. skip.\n",
+                    memfile, linecnt);
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+/**********************************************************************/
+ullint Board::gettime()
+{
+    static ullint start = 0;
+    ullint tm;
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    tm = tv.tv_sec * 1000000ull + tv.tv_usec;
+    if (start == 0)
+        start = tm;
+    return tm - start;
+}
+
+/**********************************************************************/
+int Board::siminit(char *arg)
+{
+    if (arg == NULL)
+        return 1;
+    if (arg[0] == '\0')
+        return 1;
+
+    int num, argc = 0;
+    int arglen = strlen(arg);
+    char *head = new char[arglen + 1];
+    memset(head, 0, arglen + 1);
+    char *temp = new char[arglen + 1];
+    strcpy(temp, arg);
+    char flag = ' ';
+
+    for (int i = 0; i < arglen; i++) {
+        if ((temp[i] == '"') || (temp[i] == '\'')) {
+            if (flag == temp[i]) {
+                temp[i] = '\0';
+                flag = ' ';
+            } else if ((flag != '"') && (flag != '\'')) {
+                head[i + 1] = 1;
+                argc++;
+                flag = temp[i];
+            }
+        } else if ((temp[i] == ' ') && (flag == '\0')) {
+            temp[i] = '\0';
+            flag = ' ';
+        } else if ((temp[i] != ' ') && (flag == ' ')) {
+            head[i] = 1;
+            argc++;
+            flag = '\0';
+        }
+    }
+    if ((flag == '"') || (flag == '\'')) {
+        fprintf(stderr, "## checkarg(): syntax error\n");
+        return 1;
+    }
+    char **argv = new char*[argc + 2];
+    num = 1;
+    for (int i = 0; i < arglen; i++) {
+        if (head[i]) {
+            argv[num] = &temp[i];
+            num++;
+        }
+    }
+    argv[0] = argv[argc + 1] = NULL;
+
+    int ret = siminit(argc, argv);
+
+    DELETE_ARRAY(head);
+    DELETE_ARRAY(temp);
+    DELETE_ARRAY(argv);
+    return ret;
+}
+
+/**********************************************************************/
+int Board::siminit(int argc, char **argv)
+{
+    struct sigaction sa;
+
+    checkarg(argc, argv);
+    if (!binfile)
+        return 1;
+    if (setmemorymap())
+        return 1;
+    chip = new Chip(this, use_cp0, multicycle);
+
+    // load ELF image
+    SimLoader *ld = new SimLoader();
+    if (ld->loadfile(binfile))
+        return 1;
+    if ((ld->archtype != EM_MIPS) ||
+        (ld->filetype != ET_EXEC)) { // || (ld->dynamic)) {
+        printf("## ERROR: inproper binary: %s\n", binfile);
+        return 1;
+    }
+
+    // set registers' default value
+    chip->mips->as->pc = ld->entry;
+    chip->mips->as->r[REG_SP] = ((ld->stackptr) ? ld->stackptr :
+                                 MEM_SIZE_DEF - 0x100);
+    if (!use_cp0)
+        chip->mips->as->r[REG_T9] = chip->mips->as->pc;
+    for (int i = 0; i < ld->symtabnum; i++)
+        if (strcmp(ld->symtab[i].name, "_gp") == 0) {
+            chip->mips->as->r[REG_GP] = ld->symtab[i].addr;
+            break;
+        }
+    if (use_cp0) {
+        chip->cp0->writereg(CP0_SR______, SR_DEF);
+        chip->cp0->writereg(CP0_PAGEMASK, PAGEMASK_DEF);
+        chip->cp0->writereg(CP0_PRID____, PRID_DEF);
+        chip->cp0->writereg(CP0_CONFIG__, CONFIG_DEF);
+        chip->cp0->writereg(CP0_CONFIG1_, CONFIG1_DEF);
+    }
+
+    if (setinitialdata())
+        return 1;
+
+    // write ELF image to memory a segment at a time
+    for (int i = 0; i < ld->segtabnum; i++) {
+        segtab_t *seg = &ld->segtab[i];
+        uint032_t addr = seg->addr;
+        if (use_cp0) {
+            if ((addr < KSEG0_MIN) || (addr >= KSEG2_MIN) ||
+                (seg->memsize > KSEG2_MIN - addr)) {
+                printf("## ERROR: load to unmapped segment: 0x%08x\n",
+                       addr);
+                return 1;
+            }
+            addr &= UNMAP_MASK;
+        }
+        writeimage(addr, seg->data, seg->filesize);
+        writeimage(addr + seg->filesize, NULL,
+                   seg->memsize - seg->filesize);
+    }
+    if (demand_mem) {
+        size_t size;
+        char *file = ld->detach(&size);
+        if (file)
+            keepimage(file, size);
+    }
+    DELETE(ld);
+
+    // set up console and signal
+    if (use_ttyc)
+        ttyc = new ttyControl();
+    sa.sa_handler = sigint_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sigaction(SIGINT, &sa, NULL);
+
+    for (MemoryMap *temp = mmap; temp != NULL; temp = temp->next)
+        temp->dev->init(this);
+
+    // now, the chip is ready for execution
+    chip->maxcycle = maxcycle;
+    chip->mips->state = CPU_START;
+    if ((resumefile) && (loadcheckpoint(resumefile)))
+        return 1;
+    chip->ready = 1;
+    return 0;
+}
+
+/**********************************************************************/
+int Board::savecheckpoint(char *filename)
+{
+    Checkpoint *ck = new Checkpoint();
+    int ret = ck->open(filename, 1);
+    if (!ret) {
+        // the memory map is kept to be checked on restore
+        ck->put(&chip->cycle, sizeof(chip->cycle));
+        ck->put(&use_cp0, sizeof(use_cp0));
+        for (MemoryMap *temp = mmap; temp != NULL; temp = temp->next) {
+            ck->put(&temp->addr, sizeof(temp->addr));
+            ck->put(&temp->size, sizeof(temp->size));
+        }
+        chip->mips->save(ck);
+        if (chip->cp0)
+            chip->cp0->save(ck);
+        for (MemoryMap *temp = mmap; temp != NULL; temp = temp->next)
+            temp->dev->save(ck);
+        ret = ck->error;
+    }
+    DELETE(ck);
+    if (ret)
+        fprintf(stderr, "## can't save checkpoint: %s\n", filename);
+    else
+        printf("## checkpoint at cycle %llu: %s\n", chip->cycle, filename);
+    return ret;
+}
+
+/**********************************************************************/
+int Board::loadcheckpoint(char *filename)
+{
+    Checkpoint *ck = new Checkpoint();
+    int ret = ck->open(filename, 0);
+    if (!ret) {
+        ullint cycle;
+        int cp0;
+        ck->get(&cycle, sizeof(cycle));
+        ck->get(&cp0, sizeof(cp0));
+        ret = (cp0 != use_cp0);
+        for (MemoryMap *temp = mmap; temp != NULL; temp = temp->next) {
+            uint032_t addr, size;
+            ck->get(&addr, sizeof(addr));
+            ck->get(&size, sizeof(size));
+            ret |= ((addr != temp->addr) || (size != temp->size));
+        }
+        if (ret) {
+            fprintf(stderr, "## checkpoint of another machine: %s\n",
+                    filename);
+        } else {
+            chip->cycle = cycle;
+            chip->mips->restore(ck);
+            if (chip->cp0)
+                chip->cp0->restore(ck);
+            for (MemoryMap *temp = mmap; temp != NULL; temp = temp->next)
+                temp->dev->restore(ck);
+            ret = ck->error;
+        }
+    }
+    DELETE(ck);
+    if (ret)
+        fprintf(stderr, "## can't resume from checkpoint: %s\n", filename);
+    else
+        printf("## resumed at cycle %llu: %s\n", chip->cycle, filename);
+    return ret;
+}
+
+/**********************************************************************/
+void Board::exec()
+{
+    gettime();
+    // the loop is picked once, so the common case is compiled without
+    // any test for the debug, imix or cp0 modes
+    switch (chip->mips->mode) {
+    case 0:  loop<0>(); break;
+    case 1:  loop<1>(); break;
+    case 2:  loop<2>(); break;
+    case 3:  loop<3>(); break;
+    case 4:  loop<4>(); break;
+    case 5:  loop<5>(); break;
+    case 6:  loop<6>(); break;
+    default: loop<7>(); break;
+    }
+    printresult();
+}
+
+/**********************************************************************/
+template <int MODE> void Board::checkpoint()
+{
+    // up to a cycle the engine chosen runs, as every engine stops at
+    // maxcycle exactly.  the marker is looked for inst by inst
+    char *filename = ckptfile;
+    int reached = 0;
+    ckptfile = NULL;
+    if (ckptcycle) {
+        chip->maxcycle = (ckptcycle < maxcycle) ? ckptcycle : maxcycle;
+        loop<MODE>();
+        chip->maxcycle = maxcycle;
+        reached = (chip->cycle >= ckptcycle);
+    } else {
+        while ((!reached) && (chip->getstate() == RUNNING)) {
+            if (multicycle)
+                chip->step_multi<MODE>();
+            else
+                chip->step_funct<MODE>();
+            reached = ((chip->mips->inst->ir == CKPT_MARKER) &&
+                       (chip->mips->state == CPU_IF));
+        }
+    }
+
+    // the inst under way is finished, so the stages need not be saved
+    if ((!reached) || (!chip->mips->running()) || (recieve_int))
+        return;
+    while ((multicycle) && (chip->mips->running()) &&
+           (chip->mips->state != CPU_IF) && (chip->mips->state != CPU_WAIT))
+        chip->step_multi<MODE>();
+    savecheckpoint(filename);
+}
+
+/**********************************************************************/
+template <int MODE> void Board::profile()
+{
+    // every inst is looked at, so the engine chosen is not used.
+    // the trace has a record for each step_funct, as SimPipe fetches
+    BbvProfiler *bbv = (bbvfile) ? new BbvProfiler() : NULL;
+    InstTrace *trace = (tracefile) ? new InstTrace() : NULL;
+    if (((bbv) && (bbv->open(bbvfile, bbvinterval))) ||
+        ((trace) && (trace->open(tracefile, 1)))) {
+        DELETE(bbv);
+        DELETE(trace);
+        return;
+    }
+
+    Mips *mips = chip->mips;
+    ullint last = mips->ss->inst_count;
+    while (chip->getstate() == RUNNING) {
+        if (multicycle)
+            chip->step_multi<MODE>();
+        else
+            chip->step_funct<MODE>();
+        int counted = (mips->ss->inst_count != last);
+        if ((multicycle) && (!counted))
+            continue;
+        // an inst is counted at its fetch, but decoded later
+        while ((multicycle) && (mips->running()) &&
+               (mips->state != CPU_IF) && (mips->state != CPU_WAIT))
+            chip->step_multi<MODE>();
+        last = mips->ss->inst_count;
+        if (trace) {
+            MipsInst *inst = mips->inst;
+            traceinst_t ti;
+            ti.pc = inst->pc;
+            ti.op = inst->op;
+            ti.attr = inst->attr;
+            ti.rs = inst->rs;
+            ti.rt = inst->rt;
+            ti.rd = inst->rd;
+            ti.counted = counted;
+            ti.paddr = (inst->attr & LOADSTORE) ? mips->get_paddr() : 0;
+            trace->put(&ti);
+        }
+        if ((bbv) && (counted))
+            bbv->step(mips->inst->pc, mips->inst->attr);
+    }
+    if ((trace) && (trace->error))
+        fprintf(stderr, "## can't write trace: %s\n", tracefile);
+    DELETE(bbv);
+    DELETE(trace);
+}
+
+/**********************************************************************/
+template <int MODE> void Board::loop()
+{
+    if (ckptfile)
+        checkpoint<MODE>();
+    if ((bbvfile) || (tracefile)) {
+        profile<MODE>();
+    } else if (multicycle) {
+        while (chip->getstate() == RUNNING)
+            chip->step_multi<MODE>();
+    } else if ((engine == ENGINE_THREAD) && (debug_mode != DEB_REG)) {
+        // register tracing needs the stages, so -d3 falls back
+        while (chip->getstate() == RUNNING)
+            chip->step_thread<MODE>();
+    } else if (((engine == ENGINE_BLOCK) || (engine == ENGINE_JIT) ||
+                (engine == ENGINE_AOT)) && (!(MODE & MODE_DEBUG))) {
+        // blocks are run as a whole, so -d2 and -d3 fall back
+        while (chip->getstate() == RUNNING)
+            chip->step_block();
+    } else {
+        while (chip->getstate() == RUNNING)
+            chip->step_funct<MODE>();
+    }
+}
+
+/**********************************************************************/
+void Board::printresult() {
+    double simtime = (double) gettime() / 1000000.0;
+
+    for (MemoryMap *temp = mmap; temp != NULL; temp = temp->next)
+        temp->dev->fini();
+
+    if      (chip->getstate() == HALT_CYCLE)
+        printf("\n## cycle count reaches the limit\n");
+    else if (chip->getstate() == HALT_MIPS)
+        printf("\n## cpu stopped\n");
+    else // (recieve_int)
+        printf("\n## interrupt\n");
+    printf("## cycle count: %llu\n", chip->cycle);
+    printf("## inst count: %llu\n", chip->mips->ss->inst_count);
+    printf("## simulation time: %8.3f\n", simtime);
+    printf("## mips: %4.3f\n\n", 
+           chip->mips->ss->inst_count / (simtime * 1000000.0));
+
+    if (debug_mode == DEB_RESULT) {
+        chip->mips->as->print();
+        if (chip->cp0)
+            chip->cp0->print();
+        chip->mc->print();
+    }
+    if (imix_mode)
+        chip->mips->ss->print();
+}
+
+/**********************************************************************/
+Chip::Chip(Board *board, int use_cp0, int multi)
+{
+    cycle = 0;
+    ready = 0;
+    nevent = 0;
+    nextevent = EVENT_NEVER;
+
+    this->board = board;
+    this->mmap = board->mmap;
+    if (use_cp0)
+        cp0 = new MipsCp0(board, this, (multi) ? 3 : 1);
+    else
+        cp0 = NULL;
+    mc = new MemoryController(mmap,
+                              (multi) ? MC_BUFFERMODE : MC_THROUGHMODE);
+    mips = new Mips(board, this);
+}
+
+/**********************************************************************/
+Chip::~Chip()
+{
+    DELETE(mips);
+    DELETE(mc);
+    DELETE(cp0);
+}
+
+/**********************************************************************/
+template <int MODE> int Chip::step_funct()
+{
+    int ret = mips->step_funct<MODE>();
+    if (++cycle >= nextevent)
+        runevents();
+    return ret;
+}
+
+/**********************************************************************/
+template <int MODE> int Chip::step_thread()
+{
+    int ret = mips->step_thread<MODE>();
+    if (++cycle >= nextevent)
+        runevents();
+    return ret;
+}
+
+/**********************************************************************/
+int Chip::step_block()
+{
+    // a block may not run past maxcycle, so -e stays exact
+    int ret = mips->step_block(maxcycle - cycle);
+    cycle += ret;
+    if (cycle >= nextevent)
+        runevents();
+    return ret;
+}
+
+/**********************************************************************/
+template <int MODE> int Chip::step_multi()
+{
+    int ret = mips->step_multi<MODE>();
+    if (++cycle >= nextevent)
+        runevents();
+    mc->step();
+    return ret;
+}
+
+/**********************************************************************/
+void Chip::schedule(ChipEvent *obj, ullint when)
+{
+    int i;
+    for (i = 0; (i < nevent) && (evobj[i] != obj); i++)
+        ;
+    if (i == nevent) {
+        if (nevent == EVENT_MAX) {
+            fprintf(stderr, "## too many events.\n");
+            return;
+        }
+        evobj[nevent++] = obj;
+    }
+    evcycle[i] = when;
+
+    nextevent = EVENT_NEVER;
+    for (i = 0; i < nevent; i++)
+        if (evcycle[i] < nextevent)
+            nextevent = evcycle[i];
+}
+
+/**********************************************************************/
+void Chip::runevents()
+{
+    // only a few objects wait for events, so they are simply scanned
+    // in the order of registration
+    nextevent = EVENT_NEVER;
+    for (int i = 0; i < nevent; i++) {
+        if (evcycle[i] <= cycle)
+            evcycle[i] = evobj[i]->event(cycle);
+        if (evcycle[i] < nextevent)
+            nextevent = evcycle[i];
+    }
+}
+
+/**********************************************************************/
+int Chip::getstate()
+{
+    if (cycle >= maxcycle)
+        return HALT_CYCLE;
+    else if (!mips->running())
+        return HALT_MIPS;
+    else if (recieve_int)
+        return HALT_INT;
+    else
+        return RUNNING;
+}
+
+/**********************************************************************/
+// SimPipe steps the chip with the step_funct() of its mode
+template int Chip::step_funct<0>();
+template int Chip::step_funct<1>();
+template int Chip::step_funct<2>();
+template int Chip::step_funct<3>();
+template int Chip::step_funct<4>();
+template int Chip::step_funct<5>();
+template int Chip::step_funct<6>();
+template int Chip::step_funct<7>();
+
+/**********************************************************************/
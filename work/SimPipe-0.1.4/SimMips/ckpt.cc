@@ -0,0 +1,60 @@
+/**********************************************************************
+ * SimMips: Simple Computer Simulator of MIPS    Arch Lab. TOKYO TECH *
+ **********************************************************************/
+#include "define.h"
+#include <zlib.h>
+
+#define CKPT_HEADER "SimMips_Checkpoint_1"
+
+/**********************************************************************/
+Checkpoint::Checkpoint()
+{
+    fp = NULL;
+    error = 0;
+}
+
+/**********************************************************************/
+Checkpoint::~Checkpoint()
+{
+    if (fp)
+        gzclose((gzFile) fp);
+}
+
+/**********************************************************************/
+int Checkpoint::open(const char *filename, int write)
+{
+    // the whole file is one gzip stream, so the pages are compressed
+    char header[sizeof(CKPT_HEADER)];
+    if ((fp = gzopen(filename, (write) ? "wb1" : "rb")) == NULL) {
+        fprintf(stderr, "## can't open checkpoint: %s\n", filename);
+        return 1;
+    }
+    if (write) {
+        put(CKPT_HEADER, sizeof(CKPT_HEADER));
+    } else {
+        get(header, sizeof(header));
+        if ((error) || (memcmp(header, CKPT_HEADER, sizeof(header)))) {
+            fprintf(stderr, "## not a checkpoint: %s\n", filename);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**********************************************************************/
+void Checkpoint::put(const void *data, uint032_t size)
+{
+    if ((!error) && (gzwrite((gzFile) fp, data, size) != (int) size))
+        error = 1;
+}
+
+/**********************************************************************/
+void Checkpoint::get(void *data, uint032_t size)
+{
+    if ((error) || (gzread((gzFile) fp, data, size) != (int) size)) {
+        memset(data, 0, size);
+        error = 1;
+    }
+}
+
+/**********************************************************************/
@@ -0,0 +1,524 @@
+/**********************************************************************
+ * SimMips: Simple Computer Simulator of MIPS    Arch Lab. TOKYO TECH *
+ **********************************************************************/
+#include "define.h"
+#include <stddef.h>
+#include <sys/mman.h>
+
+/* A block of the block engine is translated into a host function
+ *   uint f(Mips *m, MipsArchstate *as, uint008_t **hostpage,
+ *          uint008_t *codepage);
+ * which returns the number of insts executed and leaves as->pc at the
+ * next inst.  rbp holds m, rbx as, r12 the host page table and r13 the
+ * code page map of MipsInstCache.  GPRs stay in MipsArchstate, and
+ * r14/r15 keep the condition and the target of a branch across its
+ * delay slot.  Any inst not translated here, or a memory access whose
+ * page is not in the host page table, is run by callinterp(). */
+
+#define AS_R(n) ((uint032_t) (offsetof(MipsArchstate, r) + (n) * 4))
+#define AS_PC   ((uint032_t) offsetof(MipsArchstate, pc))
+#define AS_HI   ((uint032_t) offsetof(MipsArchstate, hi))
+#define AS_LO   ((uint032_t) offsetof(MipsArchstate, lo))
+#define SIMM(i) ((uint032_t) ((int032_t) ((i)->imm << 16) >> 16))
+
+enum {
+    EAX = 0, ECX = 1, EDX = 2, R14 = 14, R15 = 15,
+
+    CC_B = 0x2, CC_E = 0x4, CC_NE = 0x5,
+    CC_L = 0xc, CC_GE = 0xd, CC_LE = 0xe, CC_G = 0xf,
+    JZ = 0x84, JNZ = 0x85, JMP = 0xe9,
+
+    EXIT_KEEP = 0,  // as->pc is already set
+    EXIT_IMM = 1,
+    EXIT_R15 = 2,
+
+    J_STOP = 0,     // left to the interpreter
+    J_INLINE = 1,
+    J_BRANCH = 2,
+};
+
+typedef uint (*JitCode)(Mips *, MipsArchstate *, uint008_t **, uint008_t *);
+
+static const uint008_t prologue[] = {
+    0x53, 0x55, 0x41, 0x54, 0x41, 0x55,   // push rbx, rbp, r12, r13,
+    0x41, 0x56, 0x41, 0x57,               //      r14, r15
+    0x48, 0x83, 0xec, 0x08,               // sub rsp, 8
+    0x48, 0x89, 0xfd, 0x48, 0x89, 0xf3,   // mov rbp, rdi; mov rbx, rsi
+    0x49, 0x89, 0xd4, 0x49, 0x89, 0xcd,   // mov r12, rdx; mov r13, rcx
+};
+static const uint008_t epilogue[] = {
+    0x48, 0x83, 0xc4, 0x08,               // add rsp, 8
+    0x41, 0x5f, 0x41, 0x5e, 0x41, 0x5d,   // pop r15, r14, r13,
+    0x41, 0x5c, 0x5d, 0x5b, 0xc3,         //     r12, rbp, rbx; ret
+};
+
+/**********************************************************************/
+MipsJit::MipsJit(Mips *mips)
+{
+    this->mips = mips;
+    buf = cur = NULL;
+#if defined(__x86_64__)
+    void *p = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "## can't allocate code buffer, -b is used.\n");
+        return;
+    }
+    buf = cur = (uint008_t *) p;
+#else
+    fprintf(stderr, "## -j needs an x86-64 host, -b is used.\n");
+#endif
+}
+
+/**********************************************************************/
+MipsJit::~MipsJit()
+{
+    if (buf)
+        munmap(buf, JIT_CODE_SIZE);
+}
+
+/**********************************************************************/
+int MipsJit::ready()
+{
+    return (buf != NULL);
+}
+
+/**********************************************************************/
+int MipsJit::hasroom()
+{
+    return (cur + JIT_BLOCK_CODE <= buf + JIT_CODE_SIZE);
+}
+
+/**********************************************************************/
+void MipsJit::reset()
+{
+    cur = buf;
+}
+
+/**********************************************************************/
+uint MipsJit::run(MipsBlock *blk)
+{
+    return ((JitCode) blk->code)(mips, mips->as, mips->hostpage,
+                                 mips->ic->codepage);
+}
+
+/**********************************************************************/
+void MipsJit::compile(MipsBlock *blk)
+{
+    MipsInst *i = blk->inst;
+    uint008_t *start = cur;
+    int k, ended = 0;
+
+    blk->compiled = 1;
+    emits(prologue, sizeof(prologue));
+    for (k = 0; k < blk->ninst; k++) {
+        int type = compilable(&i[k]);
+        if (type == J_BRANCH) {
+            // a block ends with the delay slot of its branch
+            if ((k + 1 < blk->ninst) &&
+                (compilable(&i[k + 1]) == J_INLINE) &&
+                (compilebranch(&i[k], &i[k + 1], k))) {
+                ended = 1;
+                break;
+            }
+            type = J_STOP;
+        }
+        if (type == J_STOP)
+            break;
+        compileinst(&i[k], k, 0);
+    }
+    if (k == 0) {
+        cur = start;
+        blk->code = NULL;
+        return;
+    }
+    if (!ended)
+        exitblock(EXIT_IMM, i[k - 1].pc + 4, k);
+    blk->code = start;
+}
+
+/**********************************************************************/
+int MipsJit::compilable(MipsInst *i)
+{
+    switch (i->op) {
+    case BEQ______: case BEQL_____: case BNE______: case BNEL_____:
+    case BLEZ_____: case BLEZL____: case BGTZ_____: case BGTZL____:
+    case BLTZ_____: case BLTZL____: case BGEZ_____: case BGEZL____:
+    case J________: case JAL______:
+    case JR_______: case JR_HB____: case JALR_____: case JALR_HB__:
+        return J_BRANCH;
+    case SYSCALL__: case BREAK____: case WAIT_____: case ERET_____:
+    case MFC0_____: case CFC0_____: case MTC0_____:
+    case TLBR_____: case TLBWI____: case TLBWR____: case TLBP_____:
+    case FLOAT_OPS: case UNDEFINED:
+        return J_STOP;
+    }
+    if ((i->attr & BRANCH) || (i->attr & BRANCH_LIKELY) ||
+        (i->attr & BRANCH_ERET))
+        return J_STOP;
+    return J_INLINE;
+}
+
+/**********************************************************************/
+int MipsJit::compilebranch(MipsInst *b, MipsInst *d, int k)
+{
+    uint032_t target = b->pc + (SIMM(b) << 2) + 4;
+    int likely = (b->attr & BRANCH_LIKELY) ? 1 : 0;
+    int cc = -1;
+
+    if ((b->op == J________) || (b->op == JAL______))
+        target = (b->pc & 0xf0000000) | (b->addr << 2);
+    if ((b->op == JR_______) || (b->op == JR_HB____) ||
+        (b->op == JALR_____) || (b->op == JALR_HB__)) {
+        rbxop(0x8b, R15, AS_R(b->rs));
+        if (((b->op == JALR_____) || (b->op == JALR_HB__)) && (b->rd)) {
+            rbxop(0xc7, 0, AS_R(b->rd));
+            emit4(b->pc + 8);
+        }
+        emit1(0x45); emit1(0x85); emit1(0xff);         // test r15d, r15d
+        uint008_t *p = jump(JNZ);
+        callhelper((uint064_t) &MipsJit::branchzero, NULL);
+        exitblock(EXIT_IMM, b->pc + 4, k + 1);
+        settarget(p);
+        compileinst(d, k + 1, 1);
+        exitblock(EXIT_R15, 0, k + 2);
+        return 1;
+    }
+    if (target == 0)
+        return 0;
+
+    switch (b->op) {
+    case BEQ______: case BEQL_____: cc = CC_E;  break;
+    case BNE______: case BNEL_____: cc = CC_NE; break;
+    case BLEZ_____: case BLEZL____: cc = CC_LE; break;
+    case BGTZ_____: case BGTZL____: cc = CC_G;  break;
+    case BLTZ_____: case BLTZL____: cc = CC_L;  break;
+    case BGEZ_____: case BGEZL____: cc = CC_GE; break;
+    case JAL______:
+        rbxop(0xc7, 0, AS_R(REG_RA));
+        emit4(b->pc + 8);
+        break;
+    }
+    if (cc >= 0) {
+        rbxop(0x8b, EAX, AS_R(b->rs));
+        if ((cc == CC_E) || (cc == CC_NE))
+            rbxop(0x3b, EAX, AS_R(b->rt));             // cmp eax, rt
+        else {
+            emit1(0x85); emit1(0xc0);                  // test eax, eax
+        }
+        emit1(0x41); emit1(0x0f); emit1(0x90 | cc); emit1(0xc6);
+        if (likely) {
+            emit1(0x45); emit1(0x84); emit1(0xf6);     // test r14b, r14b
+            uint008_t *p = jump(JNZ);
+            exitblock(EXIT_IMM, b->pc + 8, k + 1);
+            settarget(p);
+        }
+    }
+    compileinst(d, k + 1, 1);
+    if ((cc >= 0) && (!likely)) {
+        emit1(0x45); emit1(0x84); emit1(0xf6);         // test r14b, r14b
+        uint008_t *p = jump(JZ);
+        exitblock(EXIT_IMM, target, k + 2);
+        settarget(p);
+        exitblock(EXIT_IMM, b->pc + 8, k + 2);
+    } else {
+        exitblock(EXIT_IMM, target, k + 2);
+    }
+    return 1;
+}
+
+/**********************************************************************/
+void MipsJit::compileinst(MipsInst *i, int k, int delay)
+{
+    uint032_t rs = AS_R(i->rs), rt = AS_R(i->rt), rd = AS_R(i->rd);
+    uint op = 0, sh = 0, cc = 0;
+
+    switch (i->op) {
+    case NOP______: case SSNOP____:
+        return;
+    case SLL______: sh = 0xe0; break;
+    case SRL______: sh = 0xe8; break;
+    case SRA______: sh = 0xf8; break;
+    case SLLV_____: sh = 0xe0; break;
+    case SRLV_____: sh = 0xe8; break;
+    case SRAV_____: sh = 0xf8; break;
+    case ADDU_____: op = 0x03; break;
+    case SUBU_____: op = 0x2b; break;
+    case AND______: op = 0x23; break;
+    case OR_______: op = 0x0b; break;
+    case NOR______: op = 0x0b; break;
+    case XOR______: op = 0x33; break;
+    case MUL______: op = 0x0faf; break;
+    case SLT______: op = 0x3b; cc = CC_L; break;
+    case SLTU_____: op = 0x3b; cc = CC_B; break;
+    case ADDIU____: op = 0x05; break;
+    case ANDI_____: op = 0x25; break;
+    case ORI______: op = 0x0d; break;
+    case XORI_____: op = 0x35; break;
+    case SLTI_____: op = 0x3d; cc = CC_L; break;
+    case SLTIU____: op = 0x3d; cc = CC_B; break;
+    case LB_______: case LBU______: case LH_______: case LHU______:
+    case LW_______: case SB_______: case SH_______: case SW_______:
+        compilemem(i, k, delay);
+        return;
+    }
+
+    switch (i->op) {
+    case SLL______: case SRL______: case SRA______:
+        if (i->rd) {
+            rbxop(0x8b, EAX, rt);
+            emit1(0xc1); emit1(sh); emit1(i->shamt);   // shift eax, imm
+            rbxop(0x89, EAX, rd);
+        }
+        return;
+    case SLLV_____: case SRLV_____: case SRAV_____:
+        if (i->rd) {
+            rbxop(0x8b, ECX, rs);
+            rbxop(0x8b, EAX, rt);
+            emit1(0xd3); emit1(sh);                    // shift eax, cl
+            rbxop(0x89, EAX, rd);
+        }
+        return;
+    case ADDU_____: case SUBU_____: case AND______: case OR_______:
+    case NOR______: case XOR______: case MUL______:
+    case SLT______: case SLTU_____:
+        if (i->rd) {
+            rbxop(0x8b, EAX, rs);
+            rbxop(op, EAX, rt);
+            if (i->op == NOR______) {
+                emit1(0xf7); emit1(0xd0);              // not eax
+            }
+            if (cc) {
+                emit1(0x0f); emit1(0x90 | cc); emit1(0xc0);
+                emit1(0x0f); emit1(0xb6); emit1(0xc0); // movzx eax, al
+            }
+            rbxop(0x89, EAX, rd);
+        }
+        return;
+    case ADDIU____: case SLTI_____: case SLTIU____:
+    case ANDI_____: case ORI______: case XORI_____:
+        if (i->rt) {
+            rbxop(0x8b, EAX, rs);
+            emit1(op);
+            emit4(((i->op == ANDI_____) || (i->op == ORI______) ||
+                   (i->op == XORI_____)) ? i->imm : SIMM(i));
+            if (cc) {
+                emit1(0x0f); emit1(0x90 | cc); emit1(0xc0);
+                emit1(0x0f); emit1(0xb6); emit1(0xc0); // movzx eax, al
+            }
+            rbxop(0x89, EAX, rt);
+        }
+        return;
+    case LUI______:
+        if (i->rt) {
+            rbxop(0xc7, 0, rt);
+            emit4(i->imm << 16);
+        }
+        return;
+    case MOVZ_____: case MOVN_____:
+        if (i->rd) {
+            rbxop(0x8b, EAX, rd);
+            rbxop(0x8b, ECX, rs);
+            rbxop(0x83, 7, rt);                        // cmp rt, 0
+            emit1(0);
+            emit1(0x0f); emit1((i->op == MOVZ_____) ? 0x44 : 0x45);
+            emit1(0xc1);                               // cmovcc eax, ecx
+            rbxop(0x89, EAX, rd);
+        }
+        return;
+    case MFHI_____: case MFLO_____:
+        if (i->rd) {
+            rbxop(0x8b, EAX, (i->op == MFHI_____) ? AS_HI : AS_LO);
+            rbxop(0x89, EAX, rd);
+        }
+        return;
+    case MTHI_____: case MTLO_____:
+        rbxop(0x8b, EAX, rs);
+        rbxop(0x89, EAX, (i->op == MTHI_____) ? AS_HI : AS_LO);
+        return;
+    case MULT_____: case MULTU____:
+        rbxop(0x8b, EAX, rs);
+        rbxop(0xf7, (i->op == MULT_____) ? 5 : 4, rt); // edx:eax = eax * rt
+        rbxop(0x89, EAX, AS_LO);
+        rbxop(0x89, EDX, AS_HI);
+        return;
+    }
+    slowpath(i, k, delay);
+}
+
+/**********************************************************************/
+void MipsJit::compilemem(MipsInst *i, int k, int delay)
+{
+    int store = ((i->op == SB_______) || (i->op == SH_______) ||
+                 (i->op == SW_______));
+    uint032_t mask = ((i->op == LW_______) || (i->op == SW_______)) ?
+        0xffc : ((i->op == LB_______) || (i->op == LBU______) ||
+                 (i->op == SB_______)) ? 0xfff : 0xffe;
+
+    // an access is done in the word holding it, as MainMemory does
+    if ((!store) && (!i->rt)) {
+        slowpath(i, k, delay);
+        return;
+    }
+    rbxop(0x8b, EAX, AS_R(i->rs));
+    emit1(0x05); emit4(SIMM(i));                       // add eax, simm
+    emit1(0x89); emit1(0xc2);                          // mov edx, eax
+    emit1(0xc1); emit1(0xea); emit1(12);               // shr edx, 12
+    uint008_t *code = NULL;
+    if (store) {
+        static const uint008_t cmpcode[] = {           // cmp [r13+rdx], 0
+            0x41, 0x80, 0x7c, 0x15, 0x00, 0x00,
+        };
+        emits(cmpcode, sizeof(cmpcode));
+        code = jump(JNZ);
+    }
+    static const uint008_t getpage[] = {
+        0x49, 0x8b, 0x14, 0xd4,                        // mov rdx, [r12+rdx*8]
+        0x48, 0x85, 0xd2,                              // test rdx, rdx
+    };
+    emits(getpage, sizeof(getpage));
+    uint008_t *miss = jump(JZ);
+    emit1(0x25); emit4(mask);                          // and eax, mask
+    if (store) {
+        rbxop(0x8b, ECX, AS_R(i->rt));
+        if (i->op == SH_______)
+            emit1(0x66);
+        emit1((i->op == SB_______) ? 0x88 : 0x89);     // mov [rdx+rax], ecx
+        emit1(0x0c); emit1(0x02);
+    } else {
+        switch (i->op) {
+        case LB_______: emit1(0x0f); emit1(0xbe); break;
+        case LBU______: emit1(0x0f); emit1(0xb6); break;
+        case LH_______: emit1(0x0f); emit1(0xbf); break;
+        case LHU______: emit1(0x0f); emit1(0xb7); break;
+        default:        emit1(0x8b); break;
+        }
+        emit1(0x04); emit1(0x02);                      // eax, [rdx+rax]
+        rbxop(0x89, EAX, AS_R(i->rt));
+    }
+    uint008_t *done = jump(JMP);
+    if (code)
+        settarget(code);
+    settarget(miss);
+    slowpath(i, k, delay);
+    settarget(done);
+}
+
+/**********************************************************************/
+void MipsJit::slowpath(MipsInst *i, int k, int delay)
+{
+    // in a delay slot, the branch decides the next pc anyway
+    callhelper((uint064_t) &MipsJit::callinterp, i);
+    if (!delay) {
+        emit1(0x85); emit1(0xc0);                      // test eax, eax
+        uint008_t *p = jump(JNZ);
+        exitblock(EXIT_KEEP, 0, k + 1);
+        settarget(p);
+    }
+}
+
+/**********************************************************************/
+void MipsJit::exitblock(int mode, uint032_t pc, int n)
+{
+    if (mode == EXIT_IMM) {
+        rbxop(0xc7, 0, AS_PC);
+        emit4(pc);
+    } else if (mode == EXIT_R15) {
+        rbxop(0x89, R15, AS_PC);
+    }
+    emit1(0xb8); emit4(n);                             // mov eax, n
+    emits(epilogue, sizeof(epilogue));
+}
+
+/**********************************************************************/
+void MipsJit::callhelper(uint064_t func, MipsInst *i)
+{
+    emit1(0x48); emit1(0x89); emit1(0xef);             // mov rdi, rbp
+    if (i) {
+        emit1(0x48); emit1(0xbe); emit8((uint064_t) i);// mov rsi, i
+    }
+    emit1(0x48); emit1(0xb8); emit8(func);             // mov rax, func
+    emit1(0xff); emit1(0xd0);                          // call rax
+}
+
+/**********************************************************************/
+void MipsJit::rbxop(uint op, int reg, uint032_t disp)
+{
+    // op reg, [rbx + disp32]
+    if (reg >= 8)
+        emit1(0x44);
+    if (op > 0xff)
+        emit1(op >> 8);
+    emit1(op & 0xff);
+    emit1(0x80 | ((reg & 7) << 3) | 3);
+    emit4(disp);
+}
+
+/**********************************************************************/
+uint008_t *MipsJit::jump(uint op)
+{
+    // returns the end of a rel32 to be set by settarget()
+    if (op != JMP)
+        emit1(0x0f);
+    emit1(op);
+    emit4(0);
+    return cur;
+}
+
+/**********************************************************************/
+void MipsJit::settarget(uint008_t *from)
+{
+    int032_t rel = (int032_t) (cur - from);
+    memcpy(from - 4, &rel, 4);
+}
+
+/**********************************************************************/
+void MipsJit::emit1(uint x)
+{
+    *cur++ = (uint008_t) x;
+}
+
+/**********************************************************************/
+void MipsJit::emit4(uint032_t x)
+{
+    memcpy(cur, &x, 4);
+    cur += 4;
+}
+
+/**********************************************************************/
+void MipsJit::emit8(uint064_t x)
+{
+    memcpy(cur, &x, 8);
+    cur += 8;
+}
+
+/**********************************************************************/
+void MipsJit::emits(const uint008_t *x, int n)
+{
+    memcpy(cur, x, n);
+    cur += n;
+}
+
+/**********************************************************************/
+int MipsJit::callinterp(Mips *m, MipsInst *i)
+{
+    uint gen = m->ic->generation;
+    m->inst = i;
+    m->as->pc = i->pc;
+    i->exec(m, i);
+    if (!m->running())
+        return 0;
+    m->as->pc = i->pc + 4;
+    if (i->attr & LOADSTORE)
+        m->maphost((uint032_t) m->paddr);
+    return (m->ic->generation == gen);
+}
+
+/**********************************************************************/
+void MipsJit::branchzero(Mips *m)
+{
+    printf("## Branch to zero. stop.\n");
+    m->state = CPU_ERROR;
+}
+
+/**********************************************************************/
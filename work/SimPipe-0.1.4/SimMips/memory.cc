@@ -2,6 +2,18 @@
  * SimMips: Simple Computer Simulator of MIPS    Arch Lab. TOKYO TECH *
  **********************************************************************/
 #include "define.h"
+#include <sys/mman.h>
+
+// pages hold the bytes in guest (little-endian) order
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define LE16(x) __builtin_bswap16(x)
+#define LE32(x) __builtin_bswap32(x)
+#define LE64(x) __builtin_bswap64(x)
+#else
+#define LE16(x) (x)
+#define LE32(x) (x)
+#define LE64(x) (x)
+#endif
 
 enum {
     MCO_READ = 0,
@@ -9,10 +21,25 @@ enum {
 };
 
 /************************************************************************/
-MainMemory::MainMemory(uint032_t mem_size)
+MainMemory::MainMemory(uint032_t mem_size, int use_flat)
 {
     npage = (mem_size + PAGE_SIZE - 1) / PAGE_SIZE;
-    mem_size = npage * PAGE_SIZE;
+    this->mem_size = npage * PAGE_SIZE;
+    flat = NULL;
+    if ((use_flat) && (npage)) {
+        // reserved at once and zero-filled by the host on demand
+        void *p = mmap(NULL, (size_t) npage * PAGE_SIZE,
+                       PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) {
+            fprintf(stderr, "## can't map main memory, pages are used.\n");
+        } else {
+            flat = (uint008_t *) p;
+#ifdef MADV_HUGEPAGE
+            madvise(p, (size_t) npage * PAGE_SIZE, MADV_HUGEPAGE);
+#endif
+        }
+    }
     pagetable = new uint032_t*[npage];
     external = new int[npage];
     for (uint i = 0; i < npage; i++) {
@@ -25,11 +52,13 @@ MainMemory::MainMemory(uint032_t mem_size)
 MainMemory::~MainMemory()
 {
     for (uint i = 0; i < npage; i++)
-        if (!external[i]) {
+        if ((!external[i]) && (!flat)) {
             DELETE_ARRAY(pagetable[i]);
         }
     DELETE_ARRAY(pagetable);
     DELETE_ARRAY(external);
+    if (flat)
+        munmap(flat, (size_t) npage * PAGE_SIZE);
 }
 
 /************************************************************************/
@@ -37,7 +66,7 @@ uint032_t* MainMemory::setpageentry(uint032_t addr, uint032_t *array)
 {
     if (addr >= mem_size)
         return NULL;
-    if (!external[addr / PAGE_SIZE])
+    if ((!external[addr / PAGE_SIZE]) && (!flat))
         DELETE_ARRAY(pagetable[addr / PAGE_SIZE]);
     pagetable[addr / PAGE_SIZE] = array;
     external[addr / PAGE_SIZE] = 1;
@@ -47,131 +76,167 @@ uint032_t* MainMemory::setpageentry(uint032_t addr, uint032_t *array)
 /************************************************************************/
 inline uint032_t* MainMemory::newpage(uint032_t addr)
 {
+    // the page table still marks the pages touched for print()
+    if (flat)
+        return (pagetable[addr / PAGE_SIZE] =
+                (uint032_t *) (flat + (addr & ~(PAGE_SIZE - 1))));
+
     uint032_t *page = new uint032_t[PAGE_SIZE / sizeof(uint032_t)];
-    for (uint i = 0; i < PAGE_SIZE / sizeof(uint032_t); i++)
-        page[i] = 0;
+    memset(page, 0, PAGE_SIZE);
     pagetable[addr / PAGE_SIZE] = page;
     return page;
 }
 
 /************************************************************************/
-inline uint032_t* MainMemory::getrealaddr(uint032_t addr)
+inline uint008_t* MainMemory::getrealaddr(uint032_t addr)
 {
     uint032_t *page = pagetable[addr / PAGE_SIZE];
     if (page == NULL)
         page = newpage(addr);
-    page += (addr % PAGE_SIZE) / sizeof(uint032_t);
-    return page;
+    return (uint008_t *) page + addr % PAGE_SIZE;
 }
 
 /************************************************************************/
 void MainMemory::read1b(uint032_t addr, uint008_t *data)
 {
-    uint032_t temp;
-    int offset = (addr & 0x3) * 8;
-    read4b(addr, &temp);
-    *data = (temp >> offset) & 0xff;
+    *data = *getrealaddr(addr);
 }
 
 /************************************************************************/
 void MainMemory::read2b(uint032_t addr, uint016_t *data)
 {
-    uint032_t temp;
-    int offset = (addr & 0x2) * 8;
-    read4b(addr, &temp);
-    *data = (temp >> offset) & 0xffff;
+    uint016_t temp;
+    memcpy(&temp, getrealaddr(addr & ~0x1), sizeof(temp));
+    *data = LE16(temp);
 }
 
 /************************************************************************/
 void MainMemory::read4b(uint032_t addr, uint032_t *data)
 {
-    uint032_t *mem = getrealaddr(addr);
-    *data = *mem;
+    uint032_t temp;
+    memcpy(&temp, getrealaddr(addr & ~0x3), sizeof(temp));
+    *data = LE32(temp);
 }
 
 /************************************************************************/
 void MainMemory::read8b(uint032_t addr, uint064_t *data)
 {
-    addr = addr & ~0x7;
-    uint032_t temp_h, temp_l;
-    read4b(addr, &temp_l);
-    read4b(addr + 4, &temp_h);
-    *data = ((uint064_t) temp_h << 32) | temp_l;
+    uint064_t temp;
+    memcpy(&temp, getrealaddr(addr & ~0x7), sizeof(temp));
+    *data = LE64(temp);
 }
 
 /************************************************************************/
 void MainMemory::readnb(uint032_t addr, int size, uint008_t *data)
 {
-    for (int i = 0; i < size; i++, addr++, data++)
-        read1b(addr, data);
+    // copied a page at a time
+    while (size > 0) {
+        int n = PAGE_SIZE - addr % PAGE_SIZE;
+        if (n > size)
+            n = size;
+        memcpy(data, getrealaddr(addr), n);
+        addr += n;
+        data += n;
+        size -= n;
+    }
 }
 
 /************************************************************************/
 void MainMemory::write1b(uint032_t addr, uint008_t data)
 {
-    int offset = (addr & 0x3) * 8;
-    uint032_t ins = (uint032_t) data << offset;
-    uint032_t mask = 0xff << offset;
-    uint032_t temp;
-    read4b(addr, &temp);
-    temp = ins | (temp & ~mask);
-    write4b(addr, temp);
+    *getrealaddr(addr) = data;
 }
 
 /************************************************************************/
 void MainMemory::write2b(uint032_t addr, uint016_t data)
 {
-    int offset = (addr & 0x2) * 8;
-    uint032_t ins = (uint032_t) data << offset;
-    uint032_t mask = 0xffff << offset;
-    uint032_t temp;
-    read4b(addr, &temp);
-    temp = ins | (temp & ~mask);
-    write4b(addr, temp);
+    uint016_t temp = LE16(data);
+    memcpy(getrealaddr(addr & ~0x1), &temp, sizeof(temp));
 }
 
 /************************************************************************/
 void MainMemory::write4b(uint032_t addr, uint032_t data)
 {
-    uint032_t *mem = getrealaddr(addr);
-    *mem = data;
+    uint032_t temp = LE32(data);
+    memcpy(getrealaddr(addr & ~0x3), &temp, sizeof(temp));
 }
 
 /************************************************************************/
 void MainMemory::write8b(uint032_t addr, uint064_t data)
 {
-    addr = addr & ~0x7;
-    write4b(addr, (uint032_t) data);
-    write4b(addr + 4, (uint032_t) (data >> 32));
+    uint064_t temp = LE64(data);
+    memcpy(getrealaddr(addr & ~0x7), &temp, sizeof(temp));
 }
 
 /************************************************************************/
 void MainMemory::writenb(uint032_t addr, int size, uint008_t *data)
 {
-    for (int i = 0; i < size; i++, addr++, data++)
-        write1b(addr, *data);
+    while (size > 0) {
+        int n = PAGE_SIZE - addr % PAGE_SIZE;
+        if (n > size)
+            n = size;
+        memcpy(getrealaddr(addr), data, n);
+        addr += n;
+        data += n;
+        size -= n;
+    }
+}
+
+/************************************************************************/
+uint008_t* MainMemory::gethostpage(uint032_t addr)
+{
+    return getrealaddr(addr & ~(PAGE_SIZE - 1));
 }
 
 /************************************************************************/
 void MainMemory::print()
 {
-    uint032_t *page;
+    uint008_t *page;
     for (uint i = 0; i < npage; i++) {
-        page = pagetable[i];
+        page = (uint008_t *) pagetable[i];
         if (page != NULL) {
             printf("[MEMORY BLOCK: 0x%08x]", i);
-            for (uint j = 0; j < PAGE_SIZE / sizeof(uint032_t); j++) {
-                if ((j % 4) == 0)
-                    printf("\n%08x: ", (uint)
-                           (i * PAGE_SIZE + j * sizeof(uint032_t)));
+            for (uint j = 0; j < PAGE_SIZE; j += sizeof(uint032_t)) {
+                if ((j % 16) == 0)
+                    printf("\n%08x: ", (uint) (i * PAGE_SIZE + j));
                 printf("%02x%02x%02x%02x ",
-                       page[j] & 0xff , (page[j] >> 8) & 0xff,
-                       (page[j] >> 16) & 0xff , (page[j] >> 24) & 0xff);
+                       page[j], page[j + 1], page[j + 2], page[j + 3]);
             }
             printf("\n\n");
         }
     }
 }
+
+/************************************************************************/
+void MainMemory::save(Checkpoint *ck)
+{
+    // only the pages allocated, each after its number
+    for (uint032_t i = 0; i < npage; i++) {
+        if (pagetable[i] == NULL)
+            continue;
+        ck->put(&i, sizeof(i));
+        ck->put(pagetable[i], PAGE_SIZE);
+    }
+    uint032_t end = npage;
+    ck->put(&end, sizeof(end));
+}
+
+/************************************************************************/
+void MainMemory::restore(Checkpoint *ck)
+{
+    // what is loaded before is cleared, the pages are kept allocated
+    for (uint032_t i = 0; i < npage; i++)
+        if (pagetable[i] != NULL)
+            memset(pagetable[i], 0, PAGE_SIZE);
+    for (;;) {
+        uint032_t i;
+        ck->get(&i, sizeof(i));
+        if ((ck->error) || (i >= npage))
+            break;
+        ck->get(getrealaddr(i * PAGE_SIZE), PAGE_SIZE);
+    }
+}
+
 /************************************************************************/
 MemoryMap::MemoryMap()
 {
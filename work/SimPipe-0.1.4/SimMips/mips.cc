@@ -1,907 +1,1625 @@
-/**********************************************************************
- * SimMips: Simple Computer Simulator of MIPS    Arch Lab. TOKYO TECH *
- **********************************************************************/
-#include "define.h"
-
-#define SGN(x) ((x) & 0x80000000)
-inline uint032_t exts32(uint032_t x, int y);
-
-/**********************************************************************/
-Mips::Mips(Board *board, Chip *chip)
-{
-    this->board = board;
-    this->chip = chip;
-    this->mc = chip->mc;
-    this->cp0 = chip->cp0;
-    as = new MipsArchstate();
-    ss = new MipsSimstate();
-    inst = new MipsInst();
-    state = CPU_STOP;
-    exc_occur = 0;
-    wait_cycle = 0;
-}
-
-/**********************************************************************/
-Mips::~Mips()
-{
-    DELETE(as);
-    DELETE(inst);
-}
-
-/**********************************************************************/
-int Mips::step_funct()
-{
-    if (!running())
-        return (state != CPU_ERROR) ? 0 : -1;
-    if (wait_cycle) {
-        wait_cycle--;
-        return 0;
-    }
-
-    uint064_t inst_last = ss->inst_count;
-    if (cp0)
-        if (cp0->checkinterrupt())
-            exception(EXC_INT____);
-
-    if (state == CPU_WAIT)
-        return 0;
-
-    fetch();
-    decode();
-    regfetch();
-    execute();
-    if (inst->attr & LOADSTORE) {
-        memsend();
-        memreceive();
-    }
-    writeback();
-    setnpc();
-    return (state != CPU_ERROR) ? 
-        (int) (ss->inst_count - inst_last) : -1;
-}
-
-/**********************************************************************/
-int Mips::step_multi()
-{
-    if (!running())
-        return (state != CPU_ERROR) ? 0 : -1;
-    if (wait_cycle) {
-        wait_cycle--;
-        return 0;
-    }
-
-    uint064_t inst_last = ss->inst_count;
-    if (cp0)
-        if (cp0->checkinterrupt())
-            exception(EXC_INT____);
-
-    if        (state == CPU_IF) {
-        fetch();
-    } else if (state == CPU_ID) {
-        decode();
-    } else if (state == CPU_RF) {
-        regfetch();
-    } else if (state == CPU_EX) {
-        execute();
-    } else if (state == CPU_MS) {
-        memsend();
-    } else if (state == CPU_MR) {
-        memreceive();
-    } else if (state == CPU_WB) {
-        writeback();
-        setnpc();
-    }
-    proceedstate();
-    return (state != CPU_ERROR) ? 
-        (int) (ss->inst_count - inst_last) : -1;
-}
-
-/**********************************************************************/
-inline void Mips::fetch()
-{
-    if ((exc_occur) || (!running()))
-        return;
-
-    uint064_t addr = (uint064_t) as->pc;
-    int ret;
-
-    ss->inst_count++;
-    inst->pc = as->pc;
-    inst->clearmnemonic();
-    if (cp0) {
-        if ((ret = cp0->getphaddr(inst->pc, &addr, 0)) != 0) {
-            vaddr = inst->pc;
-            exception(ret);
-            return;
-        }
-    }
-    mcid = mc->enqueue(addr, 4, NULL);
-    if (mcid < 0) {
-        printf("## fetch failure 0x%08x\n", inst->pc);
-        state = CPU_ERROR;
-    }
-}
-
-/**********************************************************************/
-inline void Mips::decode()
-{
-    if ((exc_occur) || (!running()))
-        return;
-
-    if (mc->inst[mcid].state == MCI_FAILURE) {
-        printf("## fetch failure 0x%08x\n", inst->pc);
-        state = CPU_ERROR;
-        return;
-    }
-    inst->ir = mc->inst[mcid].data032;
-    inst->decode();
-
-    if ((board->debug_mode == DEB_INST) || 
-        (board->debug_mode == DEB_REG))
-        printf("[%10lld] %08x: %s\n",
-               ss->inst_count, inst->pc, inst->getmnemonic());
-
-    if (board->imix_mode)
-        ss->imix[inst->op]++;
-}
-
-/**********************************************************************/
-inline void Mips::regfetch()
-{
-    if ((exc_occur) || (!running()))
-        return;
-
-    // NOTE: semantic 'if's are omitted for speedup
-//  if (inst->attr & READ_RS)
-        rrs = as->r[inst->rs];
-//  if (inst->attr & READ_RT)
-        rrt = as->r[inst->rt];
-//  if (inst->attr & READ_RD)
-        rrd = as->r[inst->rd];
-//  if (inst->attr & READ_HI)
-        rhi = as->hi;
-//  if (inst->attr & READ_LO)
-        rlo = as->lo;
-
-    if (board->debug_mode == DEB_REG) {
-        printf("              ");
-        if ((inst->attr & READ_RS) && (inst->rs))
-            printf("$%s>%08x ", regname[inst->rs], rrs);
-        if ((inst->attr & READ_RT) && (inst->rt))
-            printf("$%s>%08x ", regname[inst->rt], rrt);
-        if ((inst->attr & READ_RD) && (inst->rd))
-            printf("$%s>%08x ", regname[inst->rd], rrd);
-        if (inst->attr & READ_HI)
-            printf("$hi>%08x ", rhi);
-        if (inst->attr & READ_LO)
-            printf("$lo>%08x ", rlo);
-    }
-}
-
-/**********************************************************************/
-inline void Mips::execute()
-{
-    if ((exc_occur) || (!running()))
-        return;
-    int ret;
-
-    switch (inst->op) {
-    case NOP______:
-    case SSNOP____:
-    case WAIT_____:
-        // do nothing
-        break;
-    case SLL______:
-        rrd = rrt << inst->shamt;
-        break;
-    case SRL______:
-        rrd = rrt >> inst->shamt;
-        break;
-    case SRA______:
-        rrd = exts32(rrt >> inst->shamt, 32 - inst->shamt);
-        break;
-    case SLLV_____:
-        rrd = rrt << (rrs % 32);
-        break;
-    case SRLV_____:
-        rrd = rrt >> (rrs % 32);
-        break;
-    case SRAV_____:
-        rrd = exts32(rrt >> (rrs % 32), 32 - (rrs % 32));
-        break;
-    case JR_______:
-    case JR_HB____:
-        npc = rrs;
-        cond = 1;
-        break;
-    case JALR_____:
-    case JALR_HB__:
-        rrd = inst->pc + 8;
-        npc = rrs;
-        cond = 1;
-        break;
-    case MOVZ_____:
-        rrd = rrs;
-        cond = (rrt == 0);
-        break;
-    case MOVN_____:
-        rrd = rrs;
-        cond = (rrt != 0);
-        break;
-    case SYSCALL__:
-        if (cp0)
-            exception(EXC_SYSCALL);
-        else
-            syscall();
-        break;
-    case BREAK____:
-        exception(EXC_BP_____);
-        break;
-    case SYNC_____:
-        // LD/ST barrier, nothing to do for functional simulator
-        break;
-    case MFHI_____:
-        rrd = rhi;
-        break;
-    case MTHI_____:
-        rhi = rrs;
-        break;
-    case MFLO_____:
-        rrd = rlo;
-        break;
-    case MTLO_____:
-        rlo = rrs;
-        break;
-    case MULT_____:
-    {
-        int064_t temp = (int064_t)(int032_t) rrs * (int032_t) rrt;
-        rhi = (uint032_t) (temp >> 32);
-        rlo = (uint032_t) (temp & 0xffffffff);
-        break;
-    }
-    case MULTU____:
-    {
-        uint064_t temp = (uint064_t) rrs * (uint064_t) rrt;
-        rhi = (uint032_t) (temp >> 32);
-        rlo = (uint032_t) (temp & 0xffffffff);
-        break;
-    }
-    case DIV______:
-        if ((rrt != 0) && ((rrs != 0x80000000) || (rrt != 0xffffffff))) {
-            rlo = (uint032_t) ((int032_t) rrs / (int032_t) rrt);
-            rhi = (uint032_t) ((int032_t) rrs % (int032_t) rrt);
-        } else {
-            rlo = rhi = 0;
-        }
-        break;
-    case DIVU_____:
-        if (rrt != 0) {
-            rlo = rrs / rrt;
-            rhi = rrs % rrt;
-        } else {
-            rlo = rhi = 0;
-        }
-        break;
-    case ADD______:
-        rrd = rrs + rrt;
-        if ((SGN(rrs) == SGN(rrt)) && (SGN(rrs) != SGN(rrd)))
-            exception(EXC_OV_____);
-        break;
-    case ADDU_____:
-        rrd = rrs + rrt;
-        break;
-    case SUB______:
-        rrd = rrs - rrt;
-        if ((SGN(rrs) != SGN(rrt)) && (SGN(rrs) != SGN(rrd)))
-            exception(EXC_OV_____);
-        break;        
-    case SUBU_____:
-        rrd = rrs - rrt;
-        break;
-    case AND______:
-        rrd = rrs & rrt;
-        break;
-    case OR_______:
-        rrd = rrs | rrt;
-        break;
-    case XOR______:
-        rrd = rrs ^ rrt;
-        break;
-    case NOR______:
-        rrd = ~(rrs | rrt);
-        break;
-    case SLT______:
-        rrd = ((int032_t) rrs < (int032_t) rrt) ? 1 : 0;
-        break;
-    case SLTU_____:
-        rrd = (rrs < rrt) ? 1 : 0;
-        break;
-    case TGE______:
-        if ((int032_t) rrs >= (int032_t) rrt)
-            exception(EXC_TRAP___);
-        break;
-    case TGEU_____:
-        if (rrs >= rrt)
-            exception(EXC_TRAP___);
-        break;
-    case TLT______:
-        if ((int032_t) rrs < (int032_t) rrt)
-            exception(EXC_TRAP___);
-        break;
-    case TLTU_____:
-        if (rrs < rrt)
-            exception(EXC_TRAP___);
-        break;
-    case TEQ______:
-        if (rrs == rrt)
-            exception(EXC_TRAP___);        
-        break;
-    case TNE______:
-        if (rrs != rrt)
-            exception(EXC_TRAP___);        
-        break;
-    case BLTZ_____:
-    case BLTZL____:
-    case BLTZAL___:
-    case BLTZALL__:
-        npc = inst->pc + (exts32(inst->imm, 16) << 2) + 4;
-        cond = ((int032_t) rrs < 0);
-        break;
-    case BGEZ_____:
-    case BGEZL____:
-    case BGEZAL___:
-    case BGEZALL__:
-        npc = inst->pc + (exts32(inst->imm, 16) << 2) + 4;
-        cond = ((int032_t) rrs >= 0);
-        break;
-    case TGEI_____:
-        if ((int032_t) rrs >= (int032_t) exts32(inst->imm, 16))
-            exception(EXC_TRAP___);
-        break;
-    case TGEIU____:
-        if (rrs >= exts32(inst->imm, 16))
-            exception(EXC_TRAP___);
-        break;
-    case TLTI_____:
-        if ((int032_t) rrs < (int032_t) exts32(inst->imm, 16))
-            exception(EXC_TRAP___);
-        break;
-    case TLTIU____:
-        if (rrs < exts32(inst->imm, 16))
-            exception(EXC_TRAP___);
-        break;
-    case TEQI_____:
-        if (rrs == exts32(inst->imm, 16))
-            exception(EXC_TRAP___);        
-        break;
-    case TNEI_____:
-        if (rrs != exts32(inst->imm, 16))
-            exception(EXC_TRAP___);        
-        break;
-    case J________:
-    case JAL______:
-        npc = (inst->pc & 0xf0000000) | (inst->addr << 2);
-        cond = 1;
-        break;
-    case BEQ______:
-    case BEQL_____:
-        npc = inst->pc + (exts32(inst->imm, 16) << 2) + 4;
-        cond = (rrs == rrt);
-        break;
-    case BNE______:
-    case BNEL_____:
-        npc = inst->pc + (exts32(inst->imm, 16) << 2) + 4;
-        cond = (rrs != rrt);
-        break;
-    case BLEZ_____:
-    case BLEZL____:
-        npc = inst->pc + (exts32(inst->imm, 16) << 2) + 4;
-        cond = ((int032_t) rrs <= 0);
-        break;
-    case BGTZ_____:
-    case BGTZL____:
-        npc = inst->pc + (exts32(inst->imm, 16) << 2) + 4;
-        cond = ((int032_t) rrs > 0);
-        break;
-    case ADDI_____:
-        rrt = rrs + exts32(inst->imm, 16);
-        if ((SGN(rrs) == SGN(exts32(inst->imm, 16))) &&
-            (SGN(rrt) != SGN(exts32(inst->imm, 16))))
-            exception(EXC_OV_____);
-        break;
-    case ADDIU____:
-        rrt = rrs + exts32(inst->imm, 16);
-        break;
-    case SLTI_____:
-        rrt = ((int032_t) rrs < (int032_t) exts32(inst->imm, 16)) ? 1 : 0;
-        break;
-    case SLTIU____:
-        rrt = (rrs < exts32(inst->imm, 16)) ? 1 : 0;
-        break;
-    case ANDI_____:
-        rrt = rrs & inst->imm;
-        break;
-    case ORI______:
-        rrt = rrs | inst->imm;
-        break;
-    case XORI_____:
-        rrt = rrs ^ inst->imm;
-        break;
-    case LUI______:
-        rrt = inst->imm << 16;
-        break;
-    case MFC0_____:
-        if (cp0)
-            rrt = cp0->readreg(inst->rd + inst->sel * 32);
-        else
-            rrt = 0;
-        break;
-    case CFC0_____:
-        // cfc0 is defined but not used(really?)
-        rrt = 0;
-        break;
-    case MTC0_____:
-        if (cp0)
-            cp0->writereg(inst->rd + inst->sel * 32, rrt);
-        break;
-    case TLBR_____:
-        if (cp0)
-        cp0->tlbread();
-        break;
-    case TLBWI____:
-        if (cp0)
-            cp0->tlbwrite(0);
-        break;
-    case TLBWR____:
-        if (cp0)
-            cp0->tlbwrite(1);
-        break;
-    case TLBP_____:
-        if (cp0)
-            cp0->tlblookup();
-        break;
-    case ERET_____:
-        if (cp0) {
-            npc = cp0->readreg(CP0_EPC_____);
-            cond = 1;
-        } else {
-            cond = 0;
-        }
-        break;
-    case MADD_____:
-    {
-        int064_t temp = ((int064_t) rhi << 32) | rlo;
-        temp += (int064_t) rrs * (int064_t) rrt;
-        rhi = (uint032_t) (temp >> 32);
-        rlo = (uint032_t) (temp & 0xffffffff);
-        break;
-    }
-    case MADDU____:
-    {
-        int064_t temp = ((int064_t) rhi << 32) | rlo;
-        temp += (int064_t) rrs * (int064_t) rrt;
-        rhi = (uint032_t) (temp >> 32);
-        rlo = (uint032_t) (temp & 0xffffffff);
-        break;
-    }
-    case MUL______:
-    {
-        int064_t temp = (int064_t) rrs * (int064_t) rrt;
-        rrd = (uint032_t) (temp & 0xffffffff);
-        break;
-    }
-    case MSUB_____:
-    {
-        int064_t temp = ((int064_t) rhi << 32) | rlo;
-        temp -= (int064_t) rrs * (int064_t) rrt;
-        rhi = (uint032_t) (temp >> 32);
-        rlo = (uint032_t) (temp & 0xffffffff);
-        break;
-    }
-    case MSUBU____:
-    {
-        int064_t temp = ((int064_t) rhi << 32) | rlo;
-        temp -= (int064_t) rrs * (int064_t) rrt;
-        rhi = (uint032_t) (temp >> 32);
-        rlo = (uint032_t) (temp & 0xffffffff);
-        break;
-    }
-    case CLZ______:
-        for (rrd = 0; rrd < 32; rrd++)
-            if (rrs & (0x80000000u >> rrd))
-                break;
-        break;
-    case CLO______:
-        for (rrd = 0; rrd < 32; rrd++)
-            if (!(rrs & (0x80000000u >> rrd)))
-                break;
-        break;
-    case LB_______:
-    case LBU______:
-    case LWL______:
-    case LWR______:
-        vaddr = rrs + exts32(inst->imm, 16);
-        if (!cp0)
-            paddr = (uint064_t) vaddr;
-        else if ((ret = cp0->getphaddr(vaddr, &paddr, 0)) != 0)
-            exception(ret);
-        break;
-    case SB_______:
-    case SWL______:
-    case SWR______:
-        vaddr = rrs + exts32(inst->imm, 16);
-        if (!cp0)
-            paddr = (uint064_t) vaddr;
-        else if ((ret = cp0->getphaddr(vaddr, &paddr, 1)) != 0)
-            exception(ret);
-        break;
-    case LH_______:
-    case LHU______:
-        vaddr = rrs + exts32(inst->imm, 16);
-        if (!cp0)
-            paddr = (uint064_t) vaddr;
-        else if (vaddr & 0x1)
-            exception(EXC_ADEL___);
-        else if ((ret = cp0->getphaddr(vaddr, &paddr, 0)) != 0)
-            exception(ret);
-        break;
-    case SH_______:
-        vaddr = rrs + exts32(inst->imm, 16);
-        if (!cp0)
-            paddr = (uint064_t) vaddr;
-        else if (vaddr & 0x1)
-            exception(EXC_ADEL___);
-        else if ((ret = cp0->getphaddr(vaddr, &paddr, 1)) != 0)
-            exception(ret);
-        break;
-    case LW_______:
-    case LL_______:
-        vaddr = rrs + exts32(inst->imm, 16);
-        if (!cp0)
-            paddr = (uint064_t) vaddr;
-        else if (vaddr & 0x3)
-            exception(EXC_ADEL___);
-        else if ((ret = cp0->getphaddr(vaddr, &paddr, 0)) != 0)
-            exception(ret);
-        break;
-    case SW_______:
-    case SC_______:
-        vaddr = rrs + exts32(inst->imm, 16);
-        if (!cp0)
-            paddr = (uint064_t) vaddr;
-        else if (vaddr & 0x3)
-            exception(EXC_ADEL___);
-        else if ((ret = cp0->getphaddr(vaddr, &paddr, 1)) != 0)
-            exception(ret);
-        break;
-    case CACHE____:
-        // Nothing to do so far
-        break;
-    case PREF_____:
-        // Prefetch instruction, not impremented
-        break;
-    case FLOAT_OPS:
-        // floating operation, trapped if cp0 is enabled
-        if (cp0)
-            exception(EXC_CPU____ | EXC_CPU1___);
-        else {
-            printf("## Floating Instruction ! %08x: %08x\n",
-                   inst->pc, inst->ir);
-            state = CPU_ERROR;
-        }
-        break;
-    default:
-        printf("## Undefined Opcode ! %08x: %08x\n",
-                inst->pc, inst->ir);
-        state = CPU_ERROR;
-        break;
-    }
-
-    wait_cycle = inst->latency - 1;
-}
-
-/**********************************************************************/
-inline void Mips::memsend()
-{
-    if ((exc_occur) || (!running()))
-        return;
-
-    if (inst->attr & LOAD_1B) {
-        mcid = mc->enqueue(paddr, 1, NULL);
-    } else if (inst->attr & LOAD_2B) {
-        mcid = mc->enqueue(paddr, 2, NULL);
-    } else if (inst->attr & LOAD_4B_ALIGN) {
-        mcid = mc->enqueue(paddr, 4, NULL);
-    } else if (inst->attr & STORE_1B) {
-        uint008_t temp = (uint008_t) rrt;
-        mcid = mc->enqueue(paddr, 1, &temp);
-    } else if (inst->attr & STORE_2B) {
-        uint016_t temp = (uint016_t) rrt;
-        mcid = mc->enqueue(paddr, 2, &temp);
-    } else if (inst->attr & STORE_4B_ALIGN) {
-        mcid = mc->enqueue(paddr, 4, &rrt);
-    } else if (inst->attr & LOADSTORE_4B_UNALIGN) {
-        mcid = mc->enqueue(paddr & ~0x3, 4, NULL);
-    }
-    if (mcid < 0)
-        exception(EXC_DBE____);
-}
-
-/**********************************************************************/
-inline void Mips::memreceive()
-{
-    if ((exc_occur) || (!running()))
-        return;
-
-    if (mc->inst[mcid].state == MCI_FAILURE) {
-        exception(EXC_DBE____);
-        return;
-    }
-    McInst *im = &mc->inst[mcid];
-
-    if (inst->attr & LOAD_1B) {
-        rrt = ((inst->op == LBU______) ? 
-               im->data008 : exts32(im->data008, 8));
-    } else if (inst->attr & LOAD_2B) {
-        rrt = ((inst->op == LHU______) ? 
-               im->data016 : exts32(im->data016, 16));
-    } else if (inst->attr & LOAD_4B_ALIGN) {
-        rrt = im->data032;
-    } else if (inst->attr & LOAD_4B_UNALIGN) {
-        if (inst->op == LWR______) {
-            int shamt = (vaddr & 0x3) * 8;
-            uint032_t mask = 0xffffffff >> shamt;
-            rrt = ((im->data032 >> shamt) & mask) | (rrt & ~mask);
-        } else {      // LWL______
-            int shamt = 24 - (vaddr & 0x3) * 8;
-            uint032_t mask = 0xffffffff << shamt;
-            rrt = ((im->data032 << shamt) & mask) | (rrt & ~mask);
-        }
-    } else if (inst->attr & STORE_4B_UNALIGN) {
-        // TODO: failure in store cannot be trapped 
-        if (inst->op == SWR______) {
-            int shamt = (vaddr & 0x3) * 8;
-            uint032_t mask = 0xffffffff << shamt;
-            uint032_t temp = (((rrt << shamt) & mask) |
-                              (im->data032 & ~mask));
-            mc->enqueue(paddr & ~0x3, 4, &temp);
-        } else {     // SWL______
-            int shamt = 24 - (vaddr & 0x3) * 8;
-            uint032_t mask = 0xffffffff >> shamt;
-            uint032_t temp = (((rrt >> shamt) & mask) |
-                              (im->data032 & ~mask));
-            mc->enqueue(paddr & ~0x3, 4, &temp);
-        }
-    } else if (inst->op == SC_______) {
-        rrt = 1;
-    }   
-}
-
-/**********************************************************************/
-inline void Mips::writeback()
-{
-    if ((exc_occur) || (!running()))
-        return;
-    if (inst->attr & WRITE_RS)
-        as->r[inst->rs] = rrs;
-    if (inst->attr & WRITE_RT)
-        as->r[inst->rt] = rrt;
-    if (inst->attr & WRITE_RD)
-        as->r[inst->rd] = rrd;
-    if (inst->attr & WRITE_HI)
-        as->hi = rhi;
-    if (inst->attr & WRITE_LO)
-        as->lo = rlo;
-    if ((inst->attr & WRITE_RD_COND) && (cond))
-        as->r[inst->rd] = rrd;
-    if (inst->attr & WRITE_RRA)
-        as->r[REG_RA] = inst->pc + 8;
-
-    if (board->debug_mode == DEB_REG) {
-        if ((inst->attr & WRITE_RS) && (inst->rs))
-            printf("$%s<%08x ", regname[inst->rs], rrs);
-        if ((inst->attr & WRITE_RT) && (inst->rt))
-            printf("$%s<%08x ", regname[inst->rt], rrt);
-        if ((inst->attr & WRITE_RD) && (inst->rd))
-            printf("$%s<%08x ", regname[inst->rd], rrd);
-        if (inst->attr & WRITE_HI)
-            printf("$hi<%08x ", rhi);
-        if (inst->attr & WRITE_LO)
-            printf("$lo<%08x ", rlo);
-        if ((inst->attr & WRITE_RD_COND) && (inst->rd) && (cond))
-            printf("$%s<%08x ", regname[inst->rd], rrd);
-        if (inst->attr & WRITE_RRA)
-            printf("$ra<%08x ", inst->pc + 8);
-        printf("\n");
-    }
-
-    as->r[0] = 0; // yes, register $zero is always zero
-}
-
-/**********************************************************************/
-inline void Mips::setnpc()
-{
-    if (!running())
-        return;
-
-    if (exc_occur) {
-        as->pc = cp0->doexception(exc_code, as->pc, 
-                                  vaddr, (as->delay_npc) ? 1 : 0);
-        as->delay_npc = 0;
-    } else if (as->delay_npc) {
-        as->pc = as->delay_npc;
-        as->delay_npc = 0;
-    } else if (((inst->attr & BRANCH) || (inst->attr & BRANCH_LIKELY))
-               && (cond)) {
-        as->pc += 4;
-        as->delay_npc = npc;
-        if (!npc) {
-            printf("## Branch to zero. stop.\n");
-            state = CPU_ERROR;
-        }
-    } else if ((inst->attr & BRANCH_ERET) && (cond)) {
-        cp0->modifyreg(CP0_SR______, 0, 0x2);
-        as->pc = npc;
-        if (!npc) {
-            printf("## Branch to zero. stop.\n");
-            state = CPU_ERROR;
-        }
-    } else if ((inst->attr & BRANCH_LIKELY) && (!cond)) {
-        as->pc += 8;
-    } else {
-        as->pc += 4;
-    }
-
-    if ((state != CPU_ERROR) && (inst->op == WAIT_____) && (!exc_occur))
-        state = CPU_WAIT;
-
-    exc_occur = 0;
-}
-
-/**********************************************************************/
-void Mips::exception(int code)
-{
-    if (!cp0)
-        return;
-    if (exc_occur)
-        return;
-
-    exc_occur = 1;
-    exc_code = code;
-    if (state == CPU_WAIT)
-        state = CPU_WB;
-    if (board->debug_mode == DEB_EXCTLB)
-        printf("## exception #%d (PC=0x%08x vaddr=0x%08x)\n",
-               code, as->pc, vaddr);
-}
-
-/**********************************************************************/
-void Mips::syscall()
-{
-    switch (as->r[REG_V0]) {
-    case SYS_EXIT:
-        state = CPU_STOP;
-        break;
-    case SYS_WRITE:
-        if (as->r[REG_A0] == STDOUT_FILENO) {
-            for (uint i = 0; i < as->r[REG_A2]; i++) {
-                int mcid = mc->enqueue(as->r[REG_A1] + i, 1, NULL);
-                if (mcid < 0)
-                    break;
-                mc->step();
-                if (mc->inst[mcid].state == MCI_FINISH)
-                    putchar((int) mc->inst[mcid].data008);
-            }
-        }
-        as->r[REG_V0] = as->r[REG_A2];
-        as->r[REG_A3] = 0;
-        break;
-    case SYS_IOCTL:
-        as->r[REG_V0] = as->r[REG_A3] = 0;
-        break;
-    default:
-        printf("## unknown syscall #%d (see asm/unistd.h). Skip.\n",
-               as->r[REG_V0]);
-        as->r[REG_V0] = as->r[REG_A3] = 0;
-        break;
-    }
-}
-
-/**********************************************************************/
-void Mips::proceedstate()
-{
-    if (!running())
-        return;
-    else if (state == CPU_EX)
-        state = (inst->attr & LOADSTORE) ? CPU_MS : CPU_WB;
-    else if (state == CPU_WB)
-        state = CPU_IF;
-    else if (state != CPU_WAIT)
-        state++;
-}
-
-/**********************************************************************/
-int Mips::running()
-{
-    return (state > 0);
-}
-
-/**********************************************************************/
-MipsArchstate::MipsArchstate()
-{
-    for (int i = 0; i < NREG; i++)
-        r[i] = 0;
-    hi = lo = 0;
-    pc = delay_npc = 0;
-}
-
-/**********************************************************************/
-void MipsArchstate::print()
-{
-    for (int i = 0; i < NREG / 8; i++) {
-        for (int j = 0; j < 8; j++)
-            printf("$%s       ", regname[i * 8 + j]);
-        printf("\n");
-        for (int j = 0; j < 8; j++)
-            printf("%08x  ", r[i * 8 + j]);
-        printf("\n");
-    }
-    printf("pc        hi        lo\n");
-    printf("%08x  %08x  %08x\n\n", pc, hi, lo);
-}
-
-/*********************************************************************/
-MipsSimstate::MipsSimstate()
-{
-    inst_count = 0;
-    for (int i = 0; i < INST_CODE_NUM; i++)
-        imix[i] = 0;
-}
-
-/*********************************************************************/
-void MipsSimstate::print()
-{
-    ullint temp[INST_CODE_NUM];
-    ullint max, lastmax;
-    MipsInst *inst = new MipsInst();
-    int num = 0, index = 0;
-
-    memcpy(temp, imix, sizeof(imix));
-    printf("[[Instruction Statistics]]\n");
-    lastmax = 0;
-    for (int i = 0; i < INST_CODE_NUM; i++) {
-        max = 0;
-        for (int j = 0; j < INST_CODE_NUM; j++)
-            if (max < temp[j]) {
-                max = temp[j];
-                index = j;
-            }
-        if (max == 0)
-            break;
-        temp[index] = 0;
-        if (max != lastmax) {
-            lastmax = max;
-            num = i + 1;
-        }
-        inst->op = index;
-        
-        printf("[%3d] %-9s%11lld (%7.3f%%)\n",
-               num, inst->getinstname(), max,
-               (double) max / inst_count * 100.0);
-    }
-    printf("[---] Total    %11lld\n\n", inst_count);
-}
-
-/**********************************************************************/
-inline uint032_t exts32(uint032_t x, int y)
-{
-    if (y == 32)
-        return x;
-    uint032_t temp = 0xffffffff << y;
-    if (x & (1 << (y - 1)))
-        return (temp | (x & ~temp));
-    else
-        return (x & ~temp);
-}
-
-/*********************************************************************/
+/**********************************************************************
+ * SimMips: Simple Computer Simulator of MIPS    Arch Lab. TOKYO TECH *
+ **********************************************************************/
+#include "define.h"
+
+#define SGN(x) ((x) & 0x80000000)
+inline uint032_t exts32(uint032_t x, int y);
+inline MipsHandler bindhandler(uint032_t op);
+
+/**********************************************************************/
+Mips::Mips(Board *board, Chip *chip)
+{
+    this->board = board;
+    this->chip = chip;
+    this->mc = chip->mc;
+    this->cp0 = chip->cp0;
+    as = new MipsArchstate();
+    ss = new MipsSimstate();
+    ic = new MipsInstCache();
+    bc = new MipsBlockCache(ic);
+    lastblk = NULL;
+    jit = NULL;
+    aot = NULL;
+    hostpage = NULL;
+    hostinst = new McInst();
+    hostinst->state = MCI_FINISH;
+    mi = NULL;
+    if ((!cp0) && (!board->imix_mode)) {
+        if (board->engine == ENGINE_JIT) {
+            jit = new MipsJit(this);
+            if (!jit->ready())
+                DELETE(jit);
+        } else if ((board->engine == ENGINE_AOT) && (board->aotimage)) {
+            aot = new MipsAot(this, board->aotimage);
+        }
+    }
+    // main memory is accessed in place while mc is in through mode
+    if ((jit) || (aot) || (!board->multicycle)) {
+        hostpage = new uint008_t *[HOST_PAGE];
+        memset(hostpage, 0, sizeof(uint008_t *) * HOST_PAGE);
+    }
+    inst = ic->getdefault();
+    state = CPU_STOP;
+    exc_occur = 0;
+    predecoded = 0;
+    wait_cycle = 0;
+
+    // the step loops are compiled for each mode and picked once
+    mode = ((board->debug_mode == DEB_INST) ||
+            (board->debug_mode == DEB_REG)) ? MODE_DEBUG : 0;
+    if (board->imix_mode)
+        mode |= MODE_IMIX;
+    if (cp0)
+        mode |= MODE_CP0;
+}
+
+/**********************************************************************/
+Mips::~Mips()
+{
+    DELETE(as);
+    DELETE(jit);
+    DELETE(aot);
+    DELETE_ARRAY(hostpage);
+    DELETE(hostinst);
+    DELETE(bc);
+    DELETE(ic);
+}
+
+/**********************************************************************/
+int Mips::step_funct()
+{
+    switch (mode) {
+    case 0:  return step_funct<0>();
+    case 1:  return step_funct<1>();
+    case 2:  return step_funct<2>();
+    case 3:  return step_funct<3>();
+    case 4:  return step_funct<4>();
+    case 5:  return step_funct<5>();
+    case 6:  return step_funct<6>();
+    default: return step_funct<7>();
+    }
+}
+
+/**********************************************************************/
+template <int MODE> int Mips::step_funct()
+{
+    if (!running())
+        return (state != CPU_ERROR) ? 0 : -1;
+    if (wait_cycle) {
+        wait_cycle--;
+        return 0;
+    }
+
+    uint064_t inst_last = ss->inst_count;
+    if (MODE & MODE_CP0)
+        if (cp0->checkinterrupt())
+            exception(EXC_INT____);
+
+    if (state == CPU_WAIT)
+        return 0;
+
+    fetch<MODE>();
+    decode<MODE>();
+    regfetch<MODE>();
+    execute<MODE>();
+    if (inst->attr & LOADSTORE) {
+        memsend<MODE>();
+        memreceive<MODE>();
+    }
+    writeback<MODE>();
+    setnpc<MODE>();
+    return (state != CPU_ERROR) ? 
+        (int) (ss->inst_count - inst_last) : -1;
+}
+
+/**********************************************************************/
+template <int MODE> int Mips::step_thread()
+{
+    if (!running())
+        return (state != CPU_ERROR) ? 0 : -1;
+    if (wait_cycle) {
+        wait_cycle--;
+        return 0;
+    }
+
+    uint064_t inst_last = ss->inst_count;
+    if (MODE & MODE_CP0)
+        if (cp0->checkinterrupt())
+            exception(EXC_INT____);
+
+    if (state == CPU_WAIT)
+        return 0;
+
+    fetch<MODE>();
+    decode<MODE>();
+    if (!skip<MODE>())
+        inst->exec(this, inst);
+    setnpc<MODE>();
+    return (state != CPU_ERROR) ? 
+        (int) (ss->inst_count - inst_last) : -1;
+}
+
+/**********************************************************************/
+int Mips::step_block(ullint limit)
+{
+    uint064_t addr = (uint064_t) as->pc;
+
+    // interrupts, the wait state and fetch exceptions are left to
+    // step_funct(), which costs a cycle as it does in the loop
+    if ((!running()) || (wait_cycle) || (state == CPU_WAIT) ||
+        ((cp0) && ((cp0->checkinterrupt()) ||
+                   (cp0->getphaddr(as->pc, &addr, STLB_FETCH) != 0)))) {
+        step_funct();
+        return 1;
+    }
+    if ((jit) || (aot))
+        return step_native(limit);
+
+    if (bc->isstale())
+        flushblocks();
+    MipsBlock *blk = findblock(addr);
+    if (!blk) {
+        step_funct();
+        return 1;
+    }
+    return runblock(blk, limit);
+}
+
+/**********************************************************************/
+int Mips::step_native(ullint limit)
+{
+    // without cp0 nothing but the cycle limit needs a look between
+    // blocks, so a batch of them is run in a call.  what the native
+    // code can not run is left to the block engine a block at a time
+    ullint n = 0, stop = (limit < JIT_QUANTUM) ? limit : JIT_QUANTUM;
+    while ((n < stop) && (running()) && (!wait_cycle) &&
+           (state != CPU_WAIT)) {
+        if (aot) {
+            ullint c = aot->run(stop - n);
+            ss->inst_count += c;
+            n += c;
+            if (c)
+                continue;
+        }
+        if ((bc->isstale()) || ((jit) && (!jit->hasroom())))
+            flushblocks();
+        MipsBlock *blk = findblock((uint064_t) as->pc);
+        if (!blk)
+            break;
+        if ((jit) && (!blk->compiled))
+            jit->compile(blk);
+        if ((blk->code) && (!as->delay_npc) &&
+            ((ullint) blk->ninst <= limit - n)) {
+            uint c = jit->run(blk);
+            ss->inst_count += c;
+            n += c;
+        } else {
+            n += runblock(blk, limit - n);
+        }
+    }
+    inst = ic->getdefault();
+    if (n == 0) {
+        step_funct();
+        return 1;
+    }
+    return (int) n;
+}
+
+/**********************************************************************/
+void Mips::flushblocks()
+{
+    bc->flush();
+    if (jit)
+        jit->reset();
+    lastblk = NULL;
+}
+
+/**********************************************************************/
+void Mips::maphost(uint032_t addr)
+{
+    uint032_t base = addr & ~(PAGE_SIZE - 1);
+    if (hostpage[addr / PAGE_SIZE])
+        return;
+
+    // the first region hit serves the access, as in MemoryController,
+    // so the page is mapped only if the first one overlapping it covers
+    // all of it
+    for (MemoryMap *temp = board->mmap; temp != NULL; temp = temp->next) {
+        if ((base - temp->addr >= temp->size) &&
+            (temp->addr - base >= PAGE_SIZE))
+            continue;
+        if (((temp->addr % PAGE_SIZE) == 0) &&
+            (base - temp->addr < temp->size) &&
+            (base - temp->addr + PAGE_SIZE <= temp->size))
+            hostpage[addr / PAGE_SIZE] =
+                temp->dev->gethostpage(base - temp->addr);
+        return;
+    }
+}
+
+/**********************************************************************/
+inline McInst *Mips::access(uint064_t addr, uint032_t size, void *data)
+{
+    uint008_t *page;
+    if ((!hostpage) || (addr >> 32) ||
+        ((page = hostpage[addr / PAGE_SIZE]) == NULL))
+        return mcaccess(addr, size, data);
+
+    // aligned down as in MainMemory
+    uint008_t *p = page + (addr & (PAGE_SIZE - size));
+    if (data == NULL) {
+        if (size == 1)
+            hostinst->data008 = *p;
+        else if (size == 2)
+            hostinst->data016 = *(uint016_t *) p;
+        else
+            hostinst->data032 = *(uint032_t *) p;
+    } else {
+        if (size == 1)
+            *p = *(uint008_t *) data;
+        else if (size == 2)
+            *(uint016_t *) p = *(uint016_t *) data;
+        else
+            *(uint032_t *) p = *(uint032_t *) data;
+    }
+    return hostinst;
+}
+
+/**********************************************************************/
+McInst *Mips::mcaccess(uint064_t addr, uint032_t size, void *data)
+{
+    int id = mc->enqueue(addr, size, data);
+    if (id < 0)
+        return NULL;
+    // devices are left unmapped and keep going through mc
+    if ((hostpage) && (!(addr >> 32)) && (mc->inst[id].state == MCI_FINISH))
+        maphost((uint032_t) addr);
+    return &mc->inst[id];
+}
+
+/**********************************************************************/
+MipsBlock *Mips::findblock(uint064_t addr)
+{
+    MipsBlock *blk = NULL;
+    if (lastblk) {
+        for (int i = 0; i < 2; i++) {
+            MipsBlock *next = lastblk->next[i];
+            if ((next) && (next->pc == as->pc) && (next->paddr == addr)) {
+                blk = next;
+                break;
+            }
+        }
+    }
+    if (!blk) {
+        if ((blk = bc->lookup(addr, as->pc)) == NULL)
+            blk = translate(addr);
+        if ((blk) && (lastblk)) {
+            lastblk->next[lastblk->nextvictim] = blk;
+            lastblk->nextvictim ^= 1;
+        }
+    }
+    lastblk = blk;
+    return blk;
+}
+
+/**********************************************************************/
+int Mips::runblock(MipsBlock *blk, ullint limit)
+{
+    // leave the block when the control goes elsewhere (a taken branch,
+    // an exception), the cpu stops, or a store hits translated code
+    uint gen = ic->generation;
+    int n = 0;
+    for (MipsInst *i = blk->inst; (n < blk->ninst) && ((ullint) n < limit);
+         i++) {
+        inst = i;
+        ss->inst_count++;
+        if (mode & MODE_IMIX)
+            ss->imix[i->op]++;
+        i->exec(this, i);
+        if (cp0)
+            setnpc<MODE_CP0>();
+        else
+            setnpc<0>();
+        n++;
+        if ((!running()) || (state == CPU_WAIT) ||
+            (as->pc != i->pc + 4) || (ic->generation != gen))
+            break;
+    }
+    inst = ic->getdefault();
+    return n;
+}
+
+/**********************************************************************/
+MipsBlock *Mips::translate(uint064_t addr)
+{
+    MipsInst *buf = bc->reserve();
+    if (!buf) {
+        flushblocks();
+        buf = bc->reserve();
+    }
+
+    // a block ends after a delay slot, at a page boundary, or after an
+    // inst which may change the mapping or the cpu state
+    uint064_t paddr = addr;
+    uint032_t pc = as->pc;
+    int n = 0, delay = 0;
+    while (n < BC_MAXLEN) {
+        MipsInst *src = ic->lookup(addr);
+        if (!src) {
+            int id = mc->enqueue(addr, 4, NULL);
+            if ((id < 0) || (mc->inst[id].state == MCI_FAILURE))
+                break;
+            src = ic->refill(addr, mc->inst[id].data032);
+            src->exec = bindhandler(src->op);
+        }
+        buf[n] = *src;
+        buf[n].pc = pc;
+        buf[n].clearmnemonic();
+        n++;
+        if (delay)
+            break;
+        if ((src->attr & BRANCH) || (src->attr & BRANCH_LIKELY))
+            delay = 1;
+        else if ((src->attr & BRANCH_ERET) ||
+                 (src->op == SYSCALL__) || (src->op == BREAK____) ||
+                 (src->op == MTC0_____) || (src->op == TLBR_____) ||
+                 (src->op == TLBWI____) || (src->op == TLBWR____) ||
+                 (src->op == TLBP_____) || (src->op == WAIT_____) ||
+                 (src->op == FLOAT_OPS) || (src->op == UNDEFINED))
+            break;
+        addr += 4;
+        pc += 4;
+        if ((addr % PAGE_SIZE) == 0)
+            break;
+    }
+    return (n) ? bc->insert(paddr, as->pc, n) : NULL;
+}
+
+/**********************************************************************/
+template <int MODE> int Mips::step_multi()
+{
+    if (!running())
+        return (state != CPU_ERROR) ? 0 : -1;
+    if (wait_cycle) {
+        wait_cycle--;
+        return 0;
+    }
+
+    uint064_t inst_last = ss->inst_count;
+    if (MODE & MODE_CP0)
+        if (cp0->checkinterrupt())
+            exception(EXC_INT____);
+
+    if        (state == CPU_IF) {
+        fetch<MODE>();
+    } else if (state == CPU_ID) {
+        decode<MODE>();
+    } else if (state == CPU_RF) {
+        regfetch<MODE>();
+    } else if (state == CPU_EX) {
+        execute<MODE>();
+    } else if (state == CPU_MS) {
+        memsend<MODE>();
+    } else if (state == CPU_MR) {
+        memreceive<MODE>();
+    } else if (state == CPU_WB) {
+        writeback<MODE>();
+        setnpc<MODE>();
+    }
+    proceedstate();
+    return (state != CPU_ERROR) ? 
+        (int) (ss->inst_count - inst_last) : -1;
+}
+
+/**********************************************************************/
+template <int MODE> inline int Mips::skip()
+{
+    // a stage does nothing once an exception is taken or the cpu
+    // stops, and no exception is taken without cp0
+    return (((MODE & MODE_CP0) && (exc_occur)) || (!running()));
+}
+
+/**********************************************************************/
+template <int MODE> inline void Mips::fetch()
+{
+    if (skip<MODE>())
+        return;
+
+    uint064_t addr = (uint064_t) as->pc;
+    int ret;
+
+    ss->inst_count++;
+    inst->pc = as->pc;
+    inst->clearmnemonic();
+    if (MODE & MODE_CP0) {
+        if ((ret = cp0->getphaddr(inst->pc, &addr, STLB_FETCH)) != 0) {
+            vaddr = inst->pc;
+            exception(ret);
+            return;
+        }
+    }
+
+    // skip the memory access and decoding for a predecoded inst
+    MipsInst *hit = ic->lookup(addr);
+    if (hit) {
+        hit->pc = inst->pc;
+        hit->clearmnemonic();
+        inst = hit;
+        predecoded = 1;
+        return;
+    }
+    predecoded = 0;
+    ipaddr = addr;
+    mcid = mc->enqueue(addr, 4, NULL);
+    if (mcid < 0) {
+        printf("## fetch failure 0x%08x\n", inst->pc);
+        state = CPU_ERROR;
+    }
+}
+
+/**********************************************************************/
+template <int MODE> inline void Mips::decode()
+{
+    if (skip<MODE>())
+        return;
+
+    if (!predecoded) {
+        if (mc->inst[mcid].state == MCI_FAILURE) {
+            printf("## fetch failure 0x%08x\n", inst->pc);
+            state = CPU_ERROR;
+            return;
+        }
+        uint032_t pc = inst->pc;
+        inst = ic->refill(ipaddr, mc->inst[mcid].data032);
+        inst->pc = pc;
+        inst->exec = bindhandler(inst->op);
+        inst->clearmnemonic();
+    }
+
+    if (MODE & MODE_DEBUG)
+        printf("[%10lld] %08x: %s\n",
+               ss->inst_count, inst->pc, inst->getmnemonic());
+
+    if (MODE & MODE_IMIX)
+        ss->imix[inst->op]++;
+}
+
+/**********************************************************************/
+template <int MODE> inline void Mips::regfetch()
+{
+    if (skip<MODE>())
+        return;
+
+    // NOTE: semantic 'if's are omitted for speedup
+//  if (inst->attr & READ_RS)
+        rrs = as->r[inst->rs];
+//  if (inst->attr & READ_RT)
+        rrt = as->r[inst->rt];
+//  if (inst->attr & READ_RD)
+        rrd = as->r[inst->rd];
+//  if (inst->attr & READ_HI)
+        rhi = as->hi;
+//  if (inst->attr & READ_LO)
+        rlo = as->lo;
+
+    if ((MODE & MODE_DEBUG) && (board->debug_mode == DEB_REG)) {
+        printf("              ");
+        if ((inst->attr & READ_RS) && (inst->rs))
+            printf("$%s>%08x ", regname[inst->rs], rrs);
+        if ((inst->attr & READ_RT) && (inst->rt))
+            printf("$%s>%08x ", regname[inst->rt], rrt);
+        if ((inst->attr & READ_RD) && (inst->rd))
+            printf("$%s>%08x ", regname[inst->rd], rrd);
+        if (inst->attr & READ_HI)
+            printf("$hi>%08x ", rhi);
+        if (inst->attr & READ_LO)
+            printf("$lo>%08x ", rlo);
+    }
+}
+
+/**********************************************************************/
+template <int MODE> inline void Mips::execute()
+{
+    if (skip<MODE>())
+        return;
+    int ret;
+
+    switch (inst->op) {
+    case NOP______:
+    case SSNOP____:
+    case WAIT_____:
+        // do nothing
+        break;
+    case SLL______:
+        rrd = rrt << inst->shamt;
+        break;
+    case SRL______:
+        rrd = rrt >> inst->shamt;
+        break;
+    case SRA______:
+        rrd = exts32(rrt >> inst->shamt, 32 - inst->shamt);
+        break;
+    case SLLV_____:
+        rrd = rrt << (rrs % 32);
+        break;
+    case SRLV_____:
+        rrd = rrt >> (rrs % 32);
+        break;
+    case SRAV_____:
+        rrd = exts32(rrt >> (rrs % 32), 32 - (rrs % 32));
+        break;
+    case JR_______:
+    case JR_HB____:
+        npc = rrs;
+        cond = 1;
+        break;
+    case JALR_____:
+    case JALR_HB__:
+        rrd = inst->pc + 8;
+        npc = rrs;
+        cond = 1;
+        break;
+    case MOVZ_____:
+        rrd = rrs;
+        cond = (rrt == 0);
+        break;
+    case MOVN_____:
+        rrd = rrs;
+        cond = (rrt != 0);
+        break;
+    case SYSCALL__:
+        if (MODE & MODE_CP0)
+            exception(EXC_SYSCALL);
+        else
+            syscall();
+        break;
+    case BREAK____:
+        exception(EXC_BP_____);
+        break;
+    case SYNC_____:
+        // LD/ST barrier, nothing to do for functional simulator
+        break;
+    case MFHI_____:
+        rrd = rhi;
+        break;
+    case MTHI_____:
+        rhi = rrs;
+        break;
+    case MFLO_____:
+        rrd = rlo;
+        break;
+    case MTLO_____:
+        rlo = rrs;
+        break;
+    case MULT_____:
+    {
+        int064_t temp = (int064_t)(int032_t) rrs * (int032_t) rrt;
+        rhi = (uint032_t) (temp >> 32);
+        rlo = (uint032_t) (temp & 0xffffffff);
+        break;
+    }
+    case MULTU____:
+    {
+        uint064_t temp = (uint064_t) rrs * (uint064_t) rrt;
+        rhi = (uint032_t) (temp >> 32);
+        rlo = (uint032_t) (temp & 0xffffffff);
+        break;
+    }
+    case DIV______:
+        if ((rrt != 0) && ((rrs != 0x80000000) || (rrt != 0xffffffff))) {
+            rlo = (uint032_t) ((int032_t) rrs / (int032_t) rrt);
+            rhi = (uint032_t) ((int032_t) rrs % (int032_t) rrt);
+        } else {
+            rlo = rhi = 0;
+        }
+        break;
+    case DIVU_____:
+        if (rrt != 0) {
+            rlo = rrs / rrt;
+            rhi = rrs % rrt;
+        } else {
+            rlo = rhi = 0;
+        }
+        break;
+    case ADD______:
+        rrd = rrs + rrt;
+        if ((SGN(rrs) == SGN(rrt)) && (SGN(rrs) != SGN(rrd)))
+            exception(EXC_OV_____);
+        break;
+    case ADDU_____:
+        rrd = rrs + rrt;
+        break;
+    case SUB______:
+        rrd = rrs - rrt;
+        if ((SGN(rrs) != SGN(rrt)) && (SGN(rrs) != SGN(rrd)))
+            exception(EXC_OV_____);
+        break;        
+    case SUBU_____:
+        rrd = rrs - rrt;
+        break;
+    case AND______:
+        rrd = rrs & rrt;
+        break;
+    case OR_______:
+        rrd = rrs | rrt;
+        break;
+    case XOR______:
+        rrd = rrs ^ rrt;
+        break;
+    case NOR______:
+        rrd = ~(rrs | rrt);
+        break;
+    case SLT______:
+        rrd = ((int032_t) rrs < (int032_t) rrt) ? 1 : 0;
+        break;
+    case SLTU_____:
+        rrd = (rrs < rrt) ? 1 : 0;
+        break;
+    case TGE______:
+        if ((int032_t) rrs >= (int032_t) rrt)
+            exception(EXC_TRAP___);
+        break;
+    case TGEU_____:
+        if (rrs >= rrt)
+            exception(EXC_TRAP___);
+        break;
+    case TLT______:
+        if ((int032_t) rrs < (int032_t) rrt)
+            exception(EXC_TRAP___);
+        break;
+    case TLTU_____:
+        if (rrs < rrt)
+            exception(EXC_TRAP___);
+        break;
+    case TEQ______:
+        if (rrs == rrt)
+            exception(EXC_TRAP___);        
+        break;
+    case TNE______:
+        if (rrs != rrt)
+            exception(EXC_TRAP___);        
+        break;
+    case BLTZ_____:
+    case BLTZL____:
+    case BLTZAL___:
+    case BLTZALL__:
+        npc = inst->pc + (exts32(inst->imm, 16) << 2) + 4;
+        cond = ((int032_t) rrs < 0);
+        break;
+    case BGEZ_____:
+    case BGEZL____:
+    case BGEZAL___:
+    case BGEZALL__:
+        npc = inst->pc + (exts32(inst->imm, 16) << 2) + 4;
+        cond = ((int032_t) rrs >= 0);
+        break;
+    case TGEI_____:
+        if ((int032_t) rrs >= (int032_t) exts32(inst->imm, 16))
+            exception(EXC_TRAP___);
+        break;
+    case TGEIU____:
+        if (rrs >= exts32(inst->imm, 16))
+            exception(EXC_TRAP___);
+        break;
+    case TLTI_____:
+        if ((int032_t) rrs < (int032_t) exts32(inst->imm, 16))
+            exception(EXC_TRAP___);
+        break;
+    case TLTIU____:
+        if (rrs < exts32(inst->imm, 16))
+            exception(EXC_TRAP___);
+        break;
+    case TEQI_____:
+        if (rrs == exts32(inst->imm, 16))
+            exception(EXC_TRAP___);        
+        break;
+    case TNEI_____:
+        if (rrs != exts32(inst->imm, 16))
+            exception(EXC_TRAP___);        
+        break;
+    case J________:
+    case JAL______:
+        npc = (inst->pc & 0xf0000000) | (inst->addr << 2);
+        cond = 1;
+        break;
+    case BEQ______:
+    case BEQL_____:
+        npc = inst->pc + (exts32(inst->imm, 16) << 2) + 4;
+        cond = (rrs == rrt);
+        break;
+    case BNE______:
+    case BNEL_____:
+        npc = inst->pc + (exts32(inst->imm, 16) << 2) + 4;
+        cond = (rrs != rrt);
+        break;
+    case BLEZ_____:
+    case BLEZL____:
+        npc = inst->pc + (exts32(inst->imm, 16) << 2) + 4;
+        cond = ((int032_t) rrs <= 0);
+        break;
+    case BGTZ_____:
+    case BGTZL____:
+        npc = inst->pc + (exts32(inst->imm, 16) << 2) + 4;
+        cond = ((int032_t) rrs > 0);
+        break;
+    case ADDI_____:
+        rrt = rrs + exts32(inst->imm, 16);
+        if ((SGN(rrs) == SGN(exts32(inst->imm, 16))) &&
+            (SGN(rrt) != SGN(exts32(inst->imm, 16))))
+            exception(EXC_OV_____);
+        break;
+    case ADDIU____:
+        rrt = rrs + exts32(inst->imm, 16);
+        break;
+    case SLTI_____:
+        rrt = ((int032_t) rrs < (int032_t) exts32(inst->imm, 16)) ? 1 : 0;
+        break;
+    case SLTIU____:
+        rrt = (rrs < exts32(inst->imm, 16)) ? 1 : 0;
+        break;
+    case ANDI_____:
+        rrt = rrs & inst->imm;
+        break;
+    case ORI______:
+        rrt = rrs | inst->imm;
+        break;
+    case XORI_____:
+        rrt = rrs ^ inst->imm;
+        break;
+    case LUI______:
+        rrt = inst->imm << 16;
+        break;
+    case MFC0_____:
+        if (MODE & MODE_CP0)
+            rrt = cp0->readreg(inst->rd + inst->sel * 32);
+        else
+            rrt = 0;
+        break;
+    case CFC0_____:
+        // cfc0 is defined but not used(really?)
+        rrt = 0;
+        break;
+    case MTC0_____:
+        if (MODE & MODE_CP0)
+            cp0->writereg(inst->rd + inst->sel * 32, rrt);
+        break;
+    case TLBR_____:
+        if (MODE & MODE_CP0)
+        cp0->tlbread();
+        break;
+    case TLBWI____:
+        if (MODE & MODE_CP0)
+            cp0->tlbwrite(0);
+        break;
+    case TLBWR____:
+        if (MODE & MODE_CP0)
+            cp0->tlbwrite(1);
+        break;
+    case TLBP_____:
+        if (MODE & MODE_CP0)
+            cp0->tlblookup();
+        break;
+    case ERET_____:
+        if (MODE & MODE_CP0) {
+            npc = cp0->readreg(CP0_EPC_____);
+            cond = 1;
+        } else {
+            cond = 0;
+        }
+        break;
+    case MADD_____:
+    {
+        int064_t temp = ((int064_t) rhi << 32) | rlo;
+        temp += (int064_t) rrs * (int064_t) rrt;
+        rhi = (uint032_t) (temp >> 32);
+        rlo = (uint032_t) (temp & 0xffffffff);
+        break;
+    }
+    case MADDU____:
+    {
+        int064_t temp = ((int064_t) rhi << 32) | rlo;
+        temp += (int064_t) rrs * (int064_t) rrt;
+        rhi = (uint032_t) (temp >> 32);
+        rlo = (uint032_t) (temp & 0xffffffff);
+        break;
+    }
+    case MUL______:
+    {
+        int064_t temp = (int064_t) rrs * (int064_t) rrt;
+        rrd = (uint032_t) (temp & 0xffffffff);
+        break;
+    }
+    case MSUB_____:
+    {
+        int064_t temp = ((int064_t) rhi << 32) | rlo;
+        temp -= (int064_t) rrs * (int064_t) rrt;
+        rhi = (uint032_t) (temp >> 32);
+        rlo = (uint032_t) (temp & 0xffffffff);
+        break;
+    }
+    case MSUBU____:
+    {
+        int064_t temp = ((int064_t) rhi << 32) | rlo;
+        temp -= (int064_t) rrs * (int064_t) rrt;
+        rhi = (uint032_t) (temp >> 32);
+        rlo = (uint032_t) (temp & 0xffffffff);
+        break;
+    }
+    case CLZ______:
+        for (rrd = 0; rrd < 32; rrd++)
+            if (rrs & (0x80000000u >> rrd))
+                break;
+        break;
+    case CLO______:
+        for (rrd = 0; rrd < 32; rrd++)
+            if (!(rrs & (0x80000000u >> rrd)))
+                break;
+        break;
+    case LB_______:
+    case LBU______:
+    case LWL______:
+    case LWR______:
+        vaddr = rrs + exts32(inst->imm, 16);
+        if (!(MODE & MODE_CP0))
+            paddr = (uint064_t) vaddr;
+        else if ((ret = cp0->getphaddr(vaddr, &paddr, 0)) != 0)
+            exception(ret);
+        break;
+    case SB_______:
+    case SWL______:
+    case SWR______:
+        vaddr = rrs + exts32(inst->imm, 16);
+        if (!(MODE & MODE_CP0))
+            paddr = (uint064_t) vaddr;
+        else if ((ret = cp0->getphaddr(vaddr, &paddr, 1)) != 0)
+            exception(ret);
+        break;
+    case LH_______:
+    case LHU______:
+        vaddr = rrs + exts32(inst->imm, 16);
+        if (!(MODE & MODE_CP0))
+            paddr = (uint064_t) vaddr;
+        else if (vaddr & 0x1)
+            exception(EXC_ADEL___);
+        else if ((ret = cp0->getphaddr(vaddr, &paddr, 0)) != 0)
+            exception(ret);
+        break;
+    case SH_______:
+        vaddr = rrs + exts32(inst->imm, 16);
+        if (!(MODE & MODE_CP0))
+            paddr = (uint064_t) vaddr;
+        else if (vaddr & 0x1)
+            exception(EXC_ADEL___);
+        else if ((ret = cp0->getphaddr(vaddr, &paddr, 1)) != 0)
+            exception(ret);
+        break;
+    case LW_______:
+    case LL_______:
+        vaddr = rrs + exts32(inst->imm, 16);
+        if (!(MODE & MODE_CP0))
+            paddr = (uint064_t) vaddr;
+        else if (vaddr & 0x3)
+            exception(EXC_ADEL___);
+        else if ((ret = cp0->getphaddr(vaddr, &paddr, 0)) != 0)
+            exception(ret);
+        break;
+    case SW_______:
+    case SC_______:
+        vaddr = rrs + exts32(inst->imm, 16);
+        if (!(MODE & MODE_CP0))
+            paddr = (uint064_t) vaddr;
+        else if (vaddr & 0x3)
+            exception(EXC_ADEL___);
+        else if ((ret = cp0->getphaddr(vaddr, &paddr, 1)) != 0)
+            exception(ret);
+        break;
+    case CACHE____:
+        // Nothing to do so far
+        break;
+    case PREF_____:
+        // Prefetch instruction, not impremented
+        break;
+    case FLOAT_OPS:
+        // floating operation, trapped if cp0 is enabled
+        if (MODE & MODE_CP0)
+            exception(EXC_CPU____ | EXC_CPU1___);
+        else {
+            printf("## Floating Instruction ! %08x: %08x\n",
+                   inst->pc, inst->ir);
+            state = CPU_ERROR;
+        }
+        break;
+    default:
+        printf("## Undefined Opcode ! %08x: %08x\n",
+                inst->pc, inst->ir);
+        state = CPU_ERROR;
+        break;
+    }
+
+    wait_cycle = inst->latency - 1;
+}
+
+/**********************************************************************/
+template <int MODE> inline void Mips::memsend()
+{
+    if (skip<MODE>())
+        return;
+
+    if (inst->attr & STORE_ANY)
+        ic->checkstore(paddr);
+
+    mi = NULL;
+    if (inst->attr & LOAD_1B) {
+        mi = access(paddr, 1, NULL);
+    } else if (inst->attr & LOAD_2B) {
+        mi = access(paddr, 2, NULL);
+    } else if (inst->attr & LOAD_4B_ALIGN) {
+        mi = access(paddr, 4, NULL);
+    } else if (inst->attr & STORE_1B) {
+        uint008_t temp = (uint008_t) rrt;
+        mi = access(paddr, 1, &temp);
+    } else if (inst->attr & STORE_2B) {
+        uint016_t temp = (uint016_t) rrt;
+        mi = access(paddr, 2, &temp);
+    } else if (inst->attr & STORE_4B_ALIGN) {
+        mi = access(paddr, 4, &rrt);
+    } else if (inst->attr & LOADSTORE_4B_UNALIGN) {
+        mi = access(paddr & ~0x3, 4, NULL);
+    }
+    if (mi == NULL)
+        exception(EXC_DBE____);
+}
+
+/**********************************************************************/
+template <int MODE> inline void Mips::memreceive()
+{
+    if (skip<MODE>())
+        return;
+
+    if (mi->state == MCI_FAILURE) {
+        exception(EXC_DBE____);
+        return;
+    }
+    McInst *im = mi;
+
+    if (inst->attr & LOAD_1B) {
+        rrt = ((inst->op == LBU______) ? 
+               im->data008 : exts32(im->data008, 8));
+    } else if (inst->attr & LOAD_2B) {
+        rrt = ((inst->op == LHU______) ? 
+               im->data016 : exts32(im->data016, 16));
+    } else if (inst->attr & LOAD_4B_ALIGN) {
+        rrt = im->data032;
+    } else if (inst->attr & LOAD_4B_UNALIGN) {
+        if (inst->op == LWR______) {
+            int shamt = (vaddr & 0x3) * 8;
+            uint032_t mask = 0xffffffff >> shamt;
+            rrt = ((im->data032 >> shamt) & mask) | (rrt & ~mask);
+        } else {      // LWL______
+            int shamt = 24 - (vaddr & 0x3) * 8;
+            uint032_t mask = 0xffffffff << shamt;
+            rrt = ((im->data032 << shamt) & mask) | (rrt & ~mask);
+        }
+    } else if (inst->attr & STORE_4B_UNALIGN) {
+        // TODO: failure in store cannot be trapped 
+        if (inst->op == SWR______) {
+            int shamt = (vaddr & 0x3) * 8;
+            uint032_t mask = 0xffffffff << shamt;
+            uint032_t temp = (((rrt << shamt) & mask) |
+                              (im->data032 & ~mask));
+            access(paddr & ~0x3, 4, &temp);
+        } else {     // SWL______
+            int shamt = 24 - (vaddr & 0x3) * 8;
+            uint032_t mask = 0xffffffff >> shamt;
+            uint032_t temp = (((rrt >> shamt) & mask) |
+                              (im->data032 & ~mask));
+            access(paddr & ~0x3, 4, &temp);
+        }
+    } else if (inst->op == SC_______) {
+        rrt = 1;
+    }   
+}
+
+/**********************************************************************/
+template <int MODE> inline void Mips::writeback()
+{
+    if (skip<MODE>())
+        return;
+    if (inst->attr & WRITE_RS)
+        as->r[inst->rs] = rrs;
+    if (inst->attr & WRITE_RT)
+        as->r[inst->rt] = rrt;
+    if (inst->attr & WRITE_RD)
+        as->r[inst->rd] = rrd;
+    if (inst->attr & WRITE_HI)
+        as->hi = rhi;
+    if (inst->attr & WRITE_LO)
+        as->lo = rlo;
+    if ((inst->attr & WRITE_RD_COND) && (cond))
+        as->r[inst->rd] = rrd;
+    if (inst->attr & WRITE_RRA)
+        as->r[REG_RA] = inst->pc + 8;
+
+    if ((MODE & MODE_DEBUG) && (board->debug_mode == DEB_REG)) {
+        if ((inst->attr & WRITE_RS) && (inst->rs))
+            printf("$%s<%08x ", regname[inst->rs], rrs);
+        if ((inst->attr & WRITE_RT) && (inst->rt))
+            printf("$%s<%08x ", regname[inst->rt], rrt);
+        if ((inst->attr & WRITE_RD) && (inst->rd))
+            printf("$%s<%08x ", regname[inst->rd], rrd);
+        if (inst->attr & WRITE_HI)
+            printf("$hi<%08x ", rhi);
+        if (inst->attr & WRITE_LO)
+            printf("$lo<%08x ", rlo);
+        if ((inst->attr & WRITE_RD_COND) && (inst->rd) && (cond))
+            printf("$%s<%08x ", regname[inst->rd], rrd);
+        if (inst->attr & WRITE_RRA)
+            printf("$ra<%08x ", inst->pc + 8);
+        printf("\n");
+    }
+
+    as->r[0] = 0; // yes, register $zero is always zero
+}
+
+/**********************************************************************/
+template <int MODE> inline void Mips::setnpc()
+{
+    if (!running())
+        return;
+
+    if ((MODE & MODE_CP0) && (exc_occur)) {
+        as->pc = cp0->doexception(exc_code, as->pc, 
+                                  vaddr, (as->delay_npc) ? 1 : 0);
+        as->delay_npc = 0;
+    } else if (as->delay_npc) {
+        as->pc = as->delay_npc;
+        as->delay_npc = 0;
+    } else if (((inst->attr & BRANCH) || (inst->attr & BRANCH_LIKELY))
+               && (cond)) {
+        as->pc += 4;
+        as->delay_npc = npc;
+        if (!npc) {
+            printf("## Branch to zero. stop.\n");
+            state = CPU_ERROR;
+        }
+    } else if ((MODE & MODE_CP0) && (inst->attr & BRANCH_ERET) &&
+               (cond)) {
+        cp0->modifyreg(CP0_SR______, 0, 0x2);
+        as->pc = npc;
+        if (!npc) {
+            printf("## Branch to zero. stop.\n");
+            state = CPU_ERROR;
+        }
+    } else if ((inst->attr & BRANCH_LIKELY) && (!cond)) {
+        as->pc += 8;
+    } else {
+        as->pc += 4;
+    }
+
+    if ((state != CPU_ERROR) && (inst->op == WAIT_____) && (!exc_occur))
+        state = CPU_WAIT;
+
+    exc_occur = 0;
+}
+
+/* Threaded-code handlers: regfetch, execute, memory and writeback    */
+/* of one instruction in one shot, bound to the inst at decode        */
+/**********************************************************************/
+#define RS (m->as->r[i->rs])
+#define RT (m->as->r[i->rt])
+#define RD (m->as->r[i->rd])
+#define SIMM exts32(i->imm, 16)
+#define BRANCH_TO(cnd) {m->npc = i->pc + (SIMM << 2) + 4; m->cond = (cnd);}
+
+class MipsExec {
+ private:
+    static inline int memaddr(Mips *m, MipsInst *i, uint032_t align,
+                              int store) {
+        int ret;
+        m->vaddr = RS + SIMM;
+        if (!m->cp0) {
+            m->paddr = (uint064_t) m->vaddr;
+            return 0;
+        }
+        if (m->vaddr & align)
+            ret = EXC_ADEL___;
+        else if ((ret = m->cp0->getphaddr(m->vaddr, &m->paddr, store)) == 0)
+            return 0;
+        m->exception(ret);
+        return ret;
+    }
+    static inline McInst *load(Mips *m, uint032_t size) {
+        McInst *im = m->access(m->paddr, size, NULL);
+        if ((im == NULL) || (im->state == MCI_FAILURE)) {
+            m->exception(EXC_DBE____);
+            return NULL;
+        }
+        return im;
+    }
+    static inline void store(Mips *m, uint032_t size, void *data) {
+        m->ic->checkstore(m->paddr);
+        McInst *im = m->access(m->paddr, size, data);
+        if ((im == NULL) || (im->state == MCI_FAILURE))
+            m->exception(EXC_DBE____);
+    }
+
+ public:
+    template <int MODE> static void stages(Mips *m, MipsInst *i) {
+        m->regfetch<MODE>();
+        m->execute<MODE>();
+        if (i->attr & LOADSTORE) {
+            m->memsend<MODE>();
+            m->memreceive<MODE>();
+        }
+        m->writeback<MODE>();
+    }
+    static void generic(Mips *m, MipsInst *i) {
+        // -d3 has no threaded code, so only cp0 matters here
+        if (m->cp0)
+            stages<MODE_CP0>(m, i);
+        else
+            stages<0>(m, i);
+    }
+    static void nop(Mips *m, MipsInst *i) {}
+    static void sll(Mips *m, MipsInst *i) {
+        RD = RT << i->shamt;
+        m->as->r[0] = 0;
+    }
+    static void srl(Mips *m, MipsInst *i) {
+        RD = RT >> i->shamt;
+        m->as->r[0] = 0;
+    }
+    static void sra(Mips *m, MipsInst *i) {
+        RD = (uint032_t) ((int032_t) RT >> i->shamt);
+        m->as->r[0] = 0;
+    }
+    static void sllv(Mips *m, MipsInst *i) {
+        RD = RT << (RS % 32);
+        m->as->r[0] = 0;
+    }
+    static void srlv(Mips *m, MipsInst *i) {
+        RD = RT >> (RS % 32);
+        m->as->r[0] = 0;
+    }
+    static void srav(Mips *m, MipsInst *i) {
+        RD = (uint032_t) ((int032_t) RT >> (RS % 32));
+        m->as->r[0] = 0;
+    }
+    static void jr(Mips *m, MipsInst *i) {
+        m->npc = RS;
+        m->cond = 1;
+    }
+    static void jalr(Mips *m, MipsInst *i) {
+        m->npc = RS;
+        m->cond = 1;
+        RD = i->pc + 8;
+        m->as->r[0] = 0;
+    }
+    static void movz(Mips *m, MipsInst *i) {
+        if (RT == 0)
+            RD = RS;
+        m->as->r[0] = 0;
+    }
+    static void movn(Mips *m, MipsInst *i) {
+        if (RT != 0)
+            RD = RS;
+        m->as->r[0] = 0;
+    }
+    static void mfhi(Mips *m, MipsInst *i) {
+        RD = m->as->hi;
+        m->as->r[0] = 0;
+    }
+    static void mthi(Mips *m, MipsInst *i) {
+        m->as->hi = RS;
+    }
+    static void mflo(Mips *m, MipsInst *i) {
+        RD = m->as->lo;
+        m->as->r[0] = 0;
+    }
+    static void mtlo(Mips *m, MipsInst *i) {
+        m->as->lo = RS;
+    }
+    static void mult(Mips *m, MipsInst *i) {
+        int064_t temp = (int064_t)(int032_t) RS * (int032_t) RT;
+        m->as->hi = (uint032_t) (temp >> 32);
+        m->as->lo = (uint032_t) (temp & 0xffffffff);
+    }
+    static void multu(Mips *m, MipsInst *i) {
+        uint064_t temp = (uint064_t) RS * (uint064_t) RT;
+        m->as->hi = (uint032_t) (temp >> 32);
+        m->as->lo = (uint032_t) (temp & 0xffffffff);
+    }
+    static void div(Mips *m, MipsInst *i) {
+        uint032_t rs = RS, rt = RT;
+        if ((rt != 0) && ((rs != 0x80000000) || (rt != 0xffffffff))) {
+            m->as->lo = (uint032_t) ((int032_t) rs / (int032_t) rt);
+            m->as->hi = (uint032_t) ((int032_t) rs % (int032_t) rt);
+        } else {
+            m->as->lo = m->as->hi = 0;
+        }
+    }
+    static void divu(Mips *m, MipsInst *i) {
+        uint032_t rs = RS, rt = RT;
+        if (rt != 0) {
+            m->as->lo = rs / rt;
+            m->as->hi = rs % rt;
+        } else {
+            m->as->lo = m->as->hi = 0;
+        }
+    }
+    static void addu(Mips *m, MipsInst *i) {
+        RD = RS + RT;
+        m->as->r[0] = 0;
+    }
+    static void subu(Mips *m, MipsInst *i) {
+        RD = RS - RT;
+        m->as->r[0] = 0;
+    }
+    static void and_(Mips *m, MipsInst *i) {
+        RD = RS & RT;
+        m->as->r[0] = 0;
+    }
+    static void or_(Mips *m, MipsInst *i) {
+        RD = RS | RT;
+        m->as->r[0] = 0;
+    }
+    static void xor_(Mips *m, MipsInst *i) {
+        RD = RS ^ RT;
+        m->as->r[0] = 0;
+    }
+    static void nor(Mips *m, MipsInst *i) {
+        RD = ~(RS | RT);
+        m->as->r[0] = 0;
+    }
+    static void slt(Mips *m, MipsInst *i) {
+        RD = ((int032_t) RS < (int032_t) RT) ? 1 : 0;
+        m->as->r[0] = 0;
+    }
+    static void sltu(Mips *m, MipsInst *i) {
+        RD = (RS < RT) ? 1 : 0;
+        m->as->r[0] = 0;
+    }
+    static void mul(Mips *m, MipsInst *i) {
+        int064_t temp = (int064_t) RS * (int064_t) RT;
+        RD = (uint032_t) (temp & 0xffffffff);
+        m->as->r[0] = 0;
+    }
+    static void bltz(Mips *m, MipsInst *i) BRANCH_TO((int032_t) RS < 0)
+    static void bgez(Mips *m, MipsInst *i) BRANCH_TO((int032_t) RS >= 0)
+    static void beq(Mips *m, MipsInst *i) BRANCH_TO(RS == RT)
+    static void bne(Mips *m, MipsInst *i) BRANCH_TO(RS != RT)
+    static void blez(Mips *m, MipsInst *i) BRANCH_TO((int032_t) RS <= 0)
+    static void bgtz(Mips *m, MipsInst *i) BRANCH_TO((int032_t) RS > 0)
+    static void j(Mips *m, MipsInst *i) {
+        m->npc = (i->pc & 0xf0000000) | (i->addr << 2);
+        m->cond = 1;
+    }
+    static void jal(Mips *m, MipsInst *i) {
+        m->npc = (i->pc & 0xf0000000) | (i->addr << 2);
+        m->cond = 1;
+        m->as->r[REG_RA] = i->pc + 8;
+    }
+    static void addiu(Mips *m, MipsInst *i) {
+        RT = RS + SIMM;
+        m->as->r[0] = 0;
+    }
+    static void slti(Mips *m, MipsInst *i) {
+        RT = ((int032_t) RS < (int032_t) SIMM) ? 1 : 0;
+        m->as->r[0] = 0;
+    }
+    static void sltiu(Mips *m, MipsInst *i) {
+        RT = (RS < SIMM) ? 1 : 0;
+        m->as->r[0] = 0;
+    }
+    static void andi(Mips *m, MipsInst *i) {
+        RT = RS & i->imm;
+        m->as->r[0] = 0;
+    }
+    static void ori(Mips *m, MipsInst *i) {
+        RT = RS | i->imm;
+        m->as->r[0] = 0;
+    }
+    static void xori(Mips *m, MipsInst *i) {
+        RT = RS ^ i->imm;
+        m->as->r[0] = 0;
+    }
+    static void lui(Mips *m, MipsInst *i) {
+        RT = i->imm << 16;
+        m->as->r[0] = 0;
+    }
+    static void lb(Mips *m, MipsInst *i) {
+        McInst *im;
+        if (memaddr(m, i, 0x0, 0) || (im = load(m, 1)) == NULL)
+            return;
+        RT = (i->op == LBU______) ? im->data008 : exts32(im->data008, 8);
+        m->as->r[0] = 0;
+    }
+    static void lh(Mips *m, MipsInst *i) {
+        McInst *im;
+        if (memaddr(m, i, 0x1, 0) || (im = load(m, 2)) == NULL)
+            return;
+        RT = (i->op == LHU______) ? im->data016 : exts32(im->data016, 16);
+        m->as->r[0] = 0;
+    }
+    static void lw(Mips *m, MipsInst *i) {
+        McInst *im;
+        if (memaddr(m, i, 0x3, 0) || (im = load(m, 4)) == NULL)
+            return;
+        RT = im->data032;
+        m->as->r[0] = 0;
+    }
+    static void sb(Mips *m, MipsInst *i) {
+        uint008_t temp = (uint008_t) RT;
+        if (memaddr(m, i, 0x0, 1) == 0)
+            store(m, 1, &temp);
+    }
+    static void sh(Mips *m, MipsInst *i) {
+        uint016_t temp = (uint016_t) RT;
+        if (memaddr(m, i, 0x1, 1) == 0)
+            store(m, 2, &temp);
+    }
+    static void sw(Mips *m, MipsInst *i) {
+        uint032_t temp = RT;
+        if (memaddr(m, i, 0x3, 1) == 0)
+            store(m, 4, &temp);
+    }
+};
+
+#undef RS
+#undef RT
+#undef RD
+#undef SIMM
+#undef BRANCH_TO
+
+/**********************************************************************/
+inline MipsHandler bindhandler(uint032_t op)
+{
+    switch (op) {
+    case NOP______:
+    case SSNOP____: return MipsExec::nop;
+    case SLL______: return MipsExec::sll;
+    case SRL______: return MipsExec::srl;
+    case SRA______: return MipsExec::sra;
+    case SLLV_____: return MipsExec::sllv;
+    case SRLV_____: return MipsExec::srlv;
+    case SRAV_____: return MipsExec::srav;
+    case JR_______:
+    case JR_HB____: return MipsExec::jr;
+    case JALR_____:
+    case JALR_HB__: return MipsExec::jalr;
+    case MOVZ_____: return MipsExec::movz;
+    case MOVN_____: return MipsExec::movn;
+    case MFHI_____: return MipsExec::mfhi;
+    case MTHI_____: return MipsExec::mthi;
+    case MFLO_____: return MipsExec::mflo;
+    case MTLO_____: return MipsExec::mtlo;
+    case MULT_____: return MipsExec::mult;
+    case MULTU____: return MipsExec::multu;
+    case DIV______: return MipsExec::div;
+    case DIVU_____: return MipsExec::divu;
+    case ADDU_____: return MipsExec::addu;
+    case SUBU_____: return MipsExec::subu;
+    case AND______: return MipsExec::and_;
+    case OR_______: return MipsExec::or_;
+    case XOR______: return MipsExec::xor_;
+    case NOR______: return MipsExec::nor;
+    case SLT______: return MipsExec::slt;
+    case SLTU_____: return MipsExec::sltu;
+    case MUL______: return MipsExec::mul;
+    case BLTZ_____:
+    case BLTZL____: return MipsExec::bltz;
+    case BGEZ_____:
+    case BGEZL____: return MipsExec::bgez;
+    case BEQ______:
+    case BEQL_____: return MipsExec::beq;
+    case BNE______:
+    case BNEL_____: return MipsExec::bne;
+    case BLEZ_____:
+    case BLEZL____: return MipsExec::blez;
+    case BGTZ_____:
+    case BGTZL____: return MipsExec::bgtz;
+    case J________: return MipsExec::j;
+    case JAL______: return MipsExec::jal;
+    case ADDIU____: return MipsExec::addiu;
+    case SLTI_____: return MipsExec::slti;
+    case SLTIU____: return MipsExec::sltiu;
+    case ANDI_____: return MipsExec::andi;
+    case ORI______: return MipsExec::ori;
+    case XORI_____: return MipsExec::xori;
+    case LUI______: return MipsExec::lui;
+    case LB_______:
+    case LBU______: return MipsExec::lb;
+    case LH_______:
+    case LHU______: return MipsExec::lh;
+    case LW_______: return MipsExec::lw;
+    case SB_______: return MipsExec::sb;
+    case SH_______: return MipsExec::sh;
+    case SW_______: return MipsExec::sw;
+    default:        return MipsExec::generic;
+    }
+}
+
+/**********************************************************************/
+void Mips::exception(int code)
+{
+    if (!cp0)
+        return;
+    if (exc_occur)
+        return;
+
+    exc_occur = 1;
+    exc_code = code;
+    if (state == CPU_WAIT)
+        state = CPU_WB;
+    if (board->debug_mode == DEB_EXCTLB)
+        printf("## exception #%d (PC=0x%08x vaddr=0x%08x)\n",
+               code, as->pc, vaddr);
+}
+
+/**********************************************************************/
+void Mips::syscall()
+{
+    switch (as->r[REG_V0]) {
+    case SYS_EXIT:
+        state = CPU_STOP;
+        break;
+    case SYS_WRITE:
+        if (as->r[REG_A0] == STDOUT_FILENO) {
+            for (uint i = 0; i < as->r[REG_A2]; i++) {
+                int mcid = mc->enqueue(as->r[REG_A1] + i, 1, NULL);
+                if (mcid < 0)
+                    break;
+                mc->step();
+                if (mc->inst[mcid].state == MCI_FINISH)
+                    putchar((int) mc->inst[mcid].data008);
+            }
+        }
+        as->r[REG_V0] = as->r[REG_A2];
+        as->r[REG_A3] = 0;
+        break;
+    case SYS_IOCTL:
+        as->r[REG_V0] = as->r[REG_A3] = 0;
+        break;
+    default:
+        printf("## unknown syscall #%d (see asm/unistd.h). Skip.\n",
+               as->r[REG_V0]);
+        as->r[REG_V0] = as->r[REG_A3] = 0;
+        break;
+    }
+}
+
+/**********************************************************************/
+void Mips::proceedstate()
+{
+    if (!running())
+        return;
+    else if (state == CPU_EX)
+        state = (inst->attr & LOADSTORE) ? CPU_MS : CPU_WB;
+    else if (state == CPU_WB)
+        state = CPU_IF;
+    else if (state != CPU_WAIT)
+        state++;
+}
+
+/**********************************************************************/
+int Mips::running()
+{
+    return (state > 0);
+}
+
+/**********************************************************************/
+void Mips::save(Checkpoint *ck)
+{
+    // taken between insts, so nothing of the stages is left
+    ck->put(as, sizeof(MipsArchstate));
+    ck->put(&ss->inst_count, sizeof(ss->inst_count));
+    ck->put(&state, sizeof(state));
+    ck->put(&wait_cycle, sizeof(wait_cycle));
+}
+
+/**********************************************************************/
+void Mips::restore(Checkpoint *ck)
+{
+    // restored before the first inst, so no inst, block or host page
+    // is cached yet
+    ck->get(as, sizeof(MipsArchstate));
+    ck->get(&ss->inst_count, sizeof(ss->inst_count));
+    ck->get(&state, sizeof(state));
+    ck->get(&wait_cycle, sizeof(wait_cycle));
+}
+
+/**********************************************************************/
+MipsArchstate::MipsArchstate()
+{
+    for (int i = 0; i < NREG; i++)
+        r[i] = 0;
+    hi = lo = 0;
+    pc = delay_npc = 0;
+}
+
+/**********************************************************************/
+void MipsArchstate::print()
+{
+    for (int i = 0; i < NREG / 8; i++) {
+        for (int j = 0; j < 8; j++)
+            printf("$%s       ", regname[i * 8 + j]);
+        printf("\n");
+        for (int j = 0; j < 8; j++)
+            printf("%08x  ", r[i * 8 + j]);
+        printf("\n");
+    }
+    printf("pc        hi        lo\n");
+    printf("%08x  %08x  %08x\n\n", pc, hi, lo);
+}
+
+/*********************************************************************/
+MipsSimstate::MipsSimstate()
+{
+    inst_count = 0;
+    for (int i = 0; i < INST_CODE_NUM; i++)
+        imix[i] = 0;
+}
+
+/*********************************************************************/
+void MipsSimstate::print()
+{
+    ullint temp[INST_CODE_NUM];
+    ullint max, lastmax;
+    MipsInst *inst = new MipsInst();
+    int num = 0, index = 0;
+
+    memcpy(temp, imix, sizeof(imix));
+    printf("[[Instruction Statistics]]\n");
+    lastmax = 0;
+    for (int i = 0; i < INST_CODE_NUM; i++) {
+        max = 0;
+        for (int j = 0; j < INST_CODE_NUM; j++)
+            if (max < temp[j]) {
+                max = temp[j];
+                index = j;
+            }
+        if (max == 0)
+            break;
+        temp[index] = 0;
+        if (max != lastmax) {
+            lastmax = max;
+            num = i + 1;
+        }
+        inst->op = index;
+        
+        printf("[%3d] %-9s%11lld (%7.3f%%)\n",
+               num, inst->getinstname(), max,
+               (double) max / inst_count * 100.0);
+    }
+    printf("[---] Total    %11lld\n\n", inst_count);
+}
+
+/**********************************************************************/
+inline uint032_t exts32(uint032_t x, int y)
+{
+    if (y == 32)
+        return x;
+    uint032_t temp = 0xffffffff << y;
+    if (x & (1 << (y - 1)))
+        return (temp | (x & ~temp));
+    else
+        return (x & ~temp);
+}
+
+/**********************************************************************/
+// every mode is compiled here, Board::exec() picks the one to run
+#define MODE_INSTANTIATE(M)                       \
+    template int Mips::step_funct<M>();           \
+    template int Mips::step_multi<M>();           \
+    template int Mips::step_thread<M>();
+MODE_INSTANTIATE(0)
+MODE_INSTANTIATE(1)
+MODE_INSTANTIATE(2)
+MODE_INSTANTIATE(3)
+MODE_INSTANTIATE(4)
+MODE_INSTANTIATE(5)
+MODE_INSTANTIATE(6)
+MODE_INSTANTIATE(7)
+
+/*********************************************************************/
@@ -0,0 +1,531 @@
+/**********************************************************************
+ * SimMips: Simple Computer Simulator of MIPS    Arch Lab. TOKYO TECH *
+ **********************************************************************/
+#include "define.h"
+
+/* mips2c translates the text of a statically linked MIPS ELF into C++
+ * for the AOT engine of SimMips (MipsAot).  The blocks become cases of
+ * a switch on the pc in a single function, so a direct branch is a goto
+ * and an indirect one goes back to the switch.  A pc not translated,
+ * and the insts left out here (syscalls, cp0, unaligned accesses...),
+ * return to the block engine.  Compiled with libmips.a, the result runs
+ * as "SimMips [-options] object_file_name" without cp0. */
+
+enum {
+    K_STOP = 0,     // left to the interpreter
+    K_INLINE = 1,
+    K_BRANCH = 2,
+};
+
+/**********************************************************************/
+class Mips2c {
+ private:
+    SimLoader *ld;
+    FILE *fp;
+    uint032_t base, ninst;
+    MipsInst *inst;
+    uint008_t *leader;
+
+    int kind(MipsInst *);
+    uint032_t target(MipsInst *);
+    int isleader(uint032_t);
+    int isinline(uint032_t);
+    void setleader(uint032_t);
+    void go(uint032_t);
+    int emitinst(MipsInst *, int, int);
+    void emitbranch(MipsInst *, int);
+    void emitblock(uint032_t);
+
+ public:
+    Mips2c();
+    ~Mips2c();
+    int load(char *);
+    int translate(char *, char *);
+};
+
+/**********************************************************************/
+Mips2c::Mips2c()
+{
+    ld = new SimLoader();
+    fp = NULL;
+    inst = NULL;
+    leader = NULL;
+    base = ninst = 0;
+}
+
+/**********************************************************************/
+Mips2c::~Mips2c()
+{
+    DELETE(ld);
+    DELETE_ARRAY(inst);
+    DELETE_ARRAY(leader);
+}
+
+/**********************************************************************/
+int Mips2c::load(char *binfile)
+{
+    if (ld->loadfile(binfile))
+        return 1;
+    if ((ld->archtype != EM_MIPS) || (ld->filetype != ET_EXEC) ||
+        (!ld->textsize)) {
+        fprintf(stderr, "## ERROR: inproper binary: %s\n", binfile);
+        return 1;
+    }
+    base = ld->textbase;
+    ninst = ld->textsize / sizeof(uint032_t);
+    inst = new MipsInst[ninst];
+    leader = new uint008_t[ninst];
+    memset(leader, 0, ninst);
+
+    uint032_t *word = new uint032_t[ninst];
+    memset(word, 0, ninst * sizeof(uint032_t));
+    for (int i = 0; i < ld->segtabnum; i++) {
+        segtab_t *seg = &ld->segtab[i];
+        for (uint032_t j = 0; j < seg->filesize; j++) {
+            uint032_t off = seg->addr + j - base;
+            if (off < ninst * sizeof(uint032_t))
+                word[off / 4] |= (uint032_t) seg->data[j] << (off % 4) * 8;
+        }
+    }
+    for (uint032_t i = 0; i < ninst; i++) {
+        inst[i].ir = word[i];
+        inst[i].pc = base + i * 4;
+        inst[i].decode();
+    }
+    DELETE_ARRAY(word);
+
+    // a block starts at the entry, a symbol, a branch target, the
+    // inst after a delay slot, and the inst after one not translated
+    setleader(ld->entry);
+    setleader(base);
+    for (int i = 0; i < ld->symtabnum; i++)
+        if (ld->symtab[i].type != ST_OBJECT)
+            setleader(ld->symtab[i].addr);
+    for (uint032_t i = 0; i < ninst; i++) {
+        int k = kind(&inst[i]);
+        if (k == K_BRANCH) {
+            setleader(inst[i].pc + 8);
+            setleader(target(&inst[i]));
+        } else if (k == K_STOP) {
+            setleader(inst[i].pc + 4);
+        }
+    }
+    return 0;
+}
+
+/**********************************************************************/
+int Mips2c::kind(MipsInst *i)
+{
+    switch (i->op) {
+    case BEQ______: case BEQL_____: case BNE______: case BNEL_____:
+    case BLEZ_____: case BLEZL____: case BGTZ_____: case BGTZL____:
+    case BLTZ_____: case BLTZL____: case BGEZ_____: case BGEZL____:
+    case J________: case JAL______:
+    case JR_______: case JR_HB____: case JALR_____: case JALR_HB__:
+        return K_BRANCH;
+    case NOP______: case SSNOP____: case SYNC_____:
+    case SLL______: case SRL______: case SRA______:
+    case SLLV_____: case SRLV_____: case SRAV_____:
+    case MOVZ_____: case MOVN_____:
+    case MFHI_____: case MTHI_____: case MFLO_____: case MTLO_____:
+    case MULT_____: case MULTU____: case DIV______: case DIVU_____:
+    case ADD______: case ADDU_____: case SUB______: case SUBU_____:
+    case AND______: case OR_______: case XOR______: case NOR______:
+    case SLT______: case SLTU_____: case MUL______:
+    case CLZ______: case CLO______:
+    case TGE______: case TGEU_____: case TLT______: case TLTU_____:
+    case TEQ______: case TNE______: case TGEI_____: case TGEIU____:
+    case TLTI_____: case TLTIU____: case TEQI_____: case TNEI_____:
+    case ADDI_____: case ADDIU____: case SLTI_____: case SLTIU____:
+    case ANDI_____: case ORI______: case XORI_____: case LUI______:
+    case LB_______: case LBU______: case LH_______: case LHU______:
+    case LW_______: case SB_______: case SH_______: case SW_______:
+        return K_INLINE;
+    default:
+        return K_STOP;
+    }
+}
+
+/**********************************************************************/
+uint032_t Mips2c::target(MipsInst *i)
+{
+    if ((i->op == J________) || (i->op == JAL______))
+        return (i->pc & 0xf0000000) | (i->addr << 2);
+    return i->pc + ((uint032_t) (int032_t) (int016_t) i->imm << 2) + 4;
+}
+
+/**********************************************************************/
+int Mips2c::isleader(uint032_t pc)
+{
+    return ((pc - base < ninst * 4) && ((pc % 4) == 0) &&
+            (leader[(pc - base) / 4]));
+}
+
+/**********************************************************************/
+int Mips2c::isinline(uint032_t idx)
+{
+    // a branch is translated with its delay slot, and unless it jumps to 0
+    MipsInst *b = &inst[idx];
+    if ((idx + 1 >= ninst) || (kind(&inst[idx + 1]) != K_INLINE))
+        return 0;
+    return ((b->op == JR_______) || (b->op == JR_HB____) ||
+            (b->op == JALR_____) || (b->op == JALR_HB__) || (target(b)));
+}
+
+/**********************************************************************/
+void Mips2c::setleader(uint032_t pc)
+{
+    if ((pc - base < ninst * 4) && ((pc % 4) == 0))
+        leader[(pc - base) / 4] = 1;
+}
+
+/**********************************************************************/
+void Mips2c::go(uint032_t pc)
+{
+    if (isleader(pc))
+        fprintf(fp, "goto L%08x;\n", pc);
+    else
+        fprintf(fp, "{ as->pc = 0x%08x; return n; }\n", pc);
+}
+
+/**********************************************************************/
+int Mips2c::emitinst(MipsInst *i, int k, int delay)
+{
+    // without cp0, overflows and traps raise nothing, as in Mips
+    uint032_t simm = (uint032_t) (int032_t) (int016_t) i->imm;
+    uint rd = i->rd, rt = i->rt, rs = i->rs;
+
+    fprintf(fp, "        /* %08x: %s */\n", i->pc, i->getmnemonic());
+    switch (i->op) {
+    case SLL______: case SRL______: case SRA______:
+    case SLLV_____: case SRLV_____: case SRAV_____:
+    case MOVZ_____: case MOVN_____: case MFHI_____: case MFLO_____:
+    case ADD______: case ADDU_____: case SUB______: case SUBU_____:
+    case AND______: case OR_______: case XOR______: case NOR______:
+    case SLT______: case SLTU_____: case MUL______:
+    case CLZ______: case CLO______:
+        if (!rd)
+            return 0;
+        break;
+    case ADDI_____: case ADDIU____: case SLTI_____: case SLTIU____:
+    case ANDI_____: case ORI______: case XORI_____: case LUI______:
+        if (!rt)
+            return 0;
+        break;
+    }
+
+    switch (i->op) {
+    case SLL______:
+        fprintf(fp, "        r[%d] = r[%d] << %d;\n", rd, rt, i->shamt);
+        break;
+    case SRL______:
+        fprintf(fp, "        r[%d] = r[%d] >> %d;\n", rd, rt, i->shamt);
+        break;
+    case SRA______:
+        fprintf(fp, "        r[%d] = (uint032_t) ((int032_t) r[%d] >> %d);\n",
+                rd, rt, i->shamt);
+        break;
+    case SLLV_____:
+        fprintf(fp, "        r[%d] = r[%d] << (r[%d] %% 32);\n", rd, rt, rs);
+        break;
+    case SRLV_____:
+        fprintf(fp, "        r[%d] = r[%d] >> (r[%d] %% 32);\n", rd, rt, rs);
+        break;
+    case SRAV_____:
+        fprintf(fp, "        r[%d] = (uint032_t) ((int032_t) r[%d] >> "
+                "(r[%d] %% 32));\n", rd, rt, rs);
+        break;
+    case MOVZ_____:
+        fprintf(fp, "        if (r[%d] == 0) r[%d] = r[%d];\n", rt, rd, rs);
+        break;
+    case MOVN_____:
+        fprintf(fp, "        if (r[%d] != 0) r[%d] = r[%d];\n", rt, rd, rs);
+        break;
+    case MFHI_____:
+        fprintf(fp, "        r[%d] = as->hi;\n", rd);
+        break;
+    case MFLO_____:
+        fprintf(fp, "        r[%d] = as->lo;\n", rd);
+        break;
+    case MTHI_____:
+        fprintf(fp, "        as->hi = r[%d];\n", rs);
+        break;
+    case MTLO_____:
+        fprintf(fp, "        as->lo = r[%d];\n", rs);
+        break;
+    case MULT_____:
+        fprintf(fp, "        t64 = (uint064_t) ((int064_t) (int032_t) r[%d] "
+                "* (int032_t) r[%d]);\n", rs, rt);
+        fprintf(fp, "        as->hi = (uint032_t) (t64 >> 32); "
+                "as->lo = (uint032_t) t64;\n");
+        break;
+    case MULTU____:
+        fprintf(fp, "        t64 = (uint064_t) r[%d] * r[%d];\n", rs, rt);
+        fprintf(fp, "        as->hi = (uint032_t) (t64 >> 32); "
+                "as->lo = (uint032_t) t64;\n");
+        break;
+    case DIV______:
+        fprintf(fp, "        if ((r[%d] != 0) && ((r[%d] != 0x80000000) || "
+                "(r[%d] != 0xffffffff))) {\n", rt, rs, rt);
+        fprintf(fp, "            v = (uint032_t) ((int032_t) r[%d] / "
+                "(int032_t) r[%d]);\n", rs, rt);
+        fprintf(fp, "            as->hi = (uint032_t) ((int032_t) r[%d] %% "
+                "(int032_t) r[%d]);\n", rs, rt);
+        fprintf(fp, "            as->lo = v;\n");
+        fprintf(fp, "        } else {\n");
+        fprintf(fp, "            as->lo = as->hi = 0;\n");
+        fprintf(fp, "        }\n");
+        break;
+    case DIVU_____:
+        fprintf(fp, "        if (r[%d] != 0) {\n", rt);
+        fprintf(fp, "            v = r[%d] / r[%d];\n", rs, rt);
+        fprintf(fp, "            as->hi = r[%d] %% r[%d];\n", rs, rt);
+        fprintf(fp, "            as->lo = v;\n");
+        fprintf(fp, "        } else {\n");
+        fprintf(fp, "            as->lo = as->hi = 0;\n");
+        fprintf(fp, "        }\n");
+        break;
+    case ADD______: case ADDU_____:
+        fprintf(fp, "        r[%d] = r[%d] + r[%d];\n", rd, rs, rt);
+        break;
+    case SUB______: case SUBU_____:
+        fprintf(fp, "        r[%d] = r[%d] - r[%d];\n", rd, rs, rt);
+        break;
+    case AND______:
+        fprintf(fp, "        r[%d] = r[%d] & r[%d];\n", rd, rs, rt);
+        break;
+    case OR_______:
+        fprintf(fp, "        r[%d] = r[%d] | r[%d];\n", rd, rs, rt);
+        break;
+    case XOR______:
+        fprintf(fp, "        r[%d] = r[%d] ^ r[%d];\n", rd, rs, rt);
+        break;
+    case NOR______:
+        fprintf(fp, "        r[%d] = ~(r[%d] | r[%d]);\n", rd, rs, rt);
+        break;
+    case SLT______:
+        fprintf(fp, "        r[%d] = ((int032_t) r[%d] < (int032_t) r[%d]);\n",
+                rd, rs, rt);
+        break;
+    case SLTU_____:
+        fprintf(fp, "        r[%d] = (r[%d] < r[%d]);\n", rd, rs, rt);
+        break;
+    case MUL______:
+        fprintf(fp, "        r[%d] = r[%d] * r[%d];\n", rd, rs, rt);
+        break;
+    case CLZ______:
+        fprintf(fp, "        r[%d] = (r[%d]) ? __builtin_clz(r[%d]) : 32;\n",
+                rd, rs, rs);
+        break;
+    case CLO______:
+        fprintf(fp, "        r[%d] = (~r[%d]) ? __builtin_clz(~r[%d]) : 32;\n",
+                rd, rs, rs);
+        break;
+    case ADDI_____: case ADDIU____:
+        fprintf(fp, "        r[%d] = r[%d] + 0x%08xu;\n", rt, rs, simm);
+        break;
+    case SLTI_____:
+        fprintf(fp, "        r[%d] = ((int032_t) r[%d] < %d);\n",
+                rt, rs, (int032_t) simm);
+        break;
+    case SLTIU____:
+        fprintf(fp, "        r[%d] = (r[%d] < 0x%08xu);\n", rt, rs, simm);
+        break;
+    case ANDI_____:
+        fprintf(fp, "        r[%d] = r[%d] & 0x%04x;\n", rt, rs, i->imm);
+        break;
+    case ORI______:
+        fprintf(fp, "        r[%d] = r[%d] | 0x%04x;\n", rt, rs, i->imm);
+        break;
+    case XORI_____:
+        fprintf(fp, "        r[%d] = r[%d] ^ 0x%04x;\n", rt, rs, i->imm);
+        break;
+    case LUI______:
+        fprintf(fp, "        r[%d] = 0x%08x;\n", rt, i->imm << 16);
+        break;
+    case LB_______: case LBU______: case LH_______: case LHU______:
+    case LW_______: {
+        int size = ((i->op == LW_______) ? 4 :
+                    ((i->op == LH_______) || (i->op == LHU______)) ? 2 : 1);
+        const char *cast = (i->op == LB_______) ? "(int008_t) " :
+            (i->op == LH_______) ? "(int016_t) " : "";
+        fprintf(fp, "        if (x->ld%d(r[%d] + 0x%08xu, &v)%s",
+                size, rs, simm, (rt) ? ")" : ");\n");
+        if (rt)
+            fprintf(fp, " r[%d] = (uint032_t) %sv;\n", rt, cast);
+        break;
+    }
+    case SB_______: case SH_______: case SW_______: {
+        int size = ((i->op == SW_______) ? 4 : (i->op == SH_______) ? 2 : 1);
+        if (delay) {
+            fprintf(fp, "        ok = x->st%d(r[%d] + 0x%08xu, r[%d]);\n",
+                    size, rs, simm, rt);
+            return 1;
+        }
+        fprintf(fp, "        if (!x->st%d(r[%d] + 0x%08xu, r[%d])) "
+                "{ as->pc = 0x%08x; return n + %d; }\n",
+                size, rs, simm, rt, i->pc + 4, k + 1);
+        break;
+    }
+    default:
+        break;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+void Mips2c::emitbranch(MipsInst *b, int k)
+{
+    MipsInst *d = b + 1;
+    uint032_t to = target(b);
+    int ind = ((b->op == JR_______) || (b->op == JR_HB____) ||
+               (b->op == JALR_____) || (b->op == JALR_HB__));
+    int likely = (b->attr & BRANCH_LIKELY) ? 1 : 0;
+    const char *cond = NULL;
+
+    fprintf(fp, "        /* %08x: %s */\n", b->pc, b->getmnemonic());
+    switch (b->op) {
+    case BEQ______: case BEQL_____:
+        cond = (b->rs == b->rt) ? "1" : "r[%d] == r[%d]";
+        break;
+    case BNE______: case BNEL_____:
+        cond = (b->rs == b->rt) ? "0" : "r[%d] != r[%d]";
+        break;
+    case BLEZ_____: case BLEZL____: cond = "(int032_t) r[%d] <= 0"; break;
+    case BGTZ_____: case BGTZL____: cond = "(int032_t) r[%d] > 0"; break;
+    case BLTZ_____: case BLTZL____: cond = "(int032_t) r[%d] < 0"; break;
+    case BGEZ_____: case BGEZL____: cond = "(int032_t) r[%d] >= 0"; break;
+    case JAL______:
+        fprintf(fp, "        r[31] = 0x%08x;\n", b->pc + 8);
+        break;
+    case JALR_____: case JALR_HB__:
+    case JR_______: case JR_HB____:
+        fprintf(fp, "        t = r[%d];\n", b->rs);
+        if ((b->op != JR_______) && (b->op != JR_HB____) && (b->rd))
+            fprintf(fp, "        r[%d] = 0x%08x;\n", b->rd, b->pc + 8);
+        fprintf(fp, "        if (!t) { x->branchzero(); as->pc = 0x%08x; "
+                "return n + %d; }\n", b->pc + 4, k + 1);
+        break;
+    }
+    if (cond) {
+        fprintf(fp, "        c = (");
+        fprintf(fp, cond, b->rs, b->rt);
+        fprintf(fp, ");\n");
+        if (likely) {
+            fprintf(fp, "        if (!c) { n += %d; ", k + 1);
+            go(b->pc + 8);
+            fprintf(fp, "        }\n");
+        }
+    }
+
+    int store = emitinst(d, k + 1, 1);
+    fprintf(fp, "        n += %d;\n", k + 2);
+    if (ind) {
+        if (store)
+            fprintf(fp, "        if (!ok) { as->pc = t; return n; }\n");
+        fprintf(fp, "        as->pc = t;\n");
+        fprintf(fp, "        goto dispatch;\n");
+    } else if ((cond) && (!likely)) {
+        if (store)
+            fprintf(fp, "        if (!ok) { as->pc = (c) ? 0x%08x : "
+                    "0x%08x; return n; }\n", to, b->pc + 8);
+        fprintf(fp, "        if (c) ");
+        go(to);
+        fprintf(fp, "        ");
+        go(b->pc + 8);
+    } else {
+        if (store)
+            fprintf(fp, "        if (!ok) { as->pc = 0x%08x; return n; }\n",
+                    to);
+        fprintf(fp, "        ");
+        go(to);
+    }
+}
+
+/**********************************************************************/
+void Mips2c::emitblock(uint032_t first)
+{
+    // a block runs up to a branch, an inst left out, or the next leader
+    uint032_t last = first;
+    while ((last < ninst) && ((last == first) || (!leader[last])) &&
+           (kind(&inst[last]) == K_INLINE))
+        last++;
+    int k = last - first;
+    int fall = ((last < ninst) && (last > first) && (leader[last]));
+    int branch = ((!fall) && (last < ninst) &&
+                  (kind(&inst[last]) == K_BRANCH) && (isinline(last)));
+    uint032_t pc = inst[first].pc;
+
+    fprintf(fp, "    case 0x%08x: L%08x:\n", pc, pc);
+    if ((k == 0) && (!branch)) {
+        fprintf(fp, "        as->pc = 0x%08x; return n;\n", pc);
+        return;
+    }
+    fprintf(fp, "        if (n + %d > limit) { as->pc = 0x%08x; "
+            "return n; }\n", k + ((branch) ? 2 : 0), pc);
+    for (int j = 0; j < k; j++)
+        emitinst(&inst[first + j], j, 0);
+    if (branch)
+        emitbranch(&inst[last], k);
+    else if (fall)
+        fprintf(fp, "        n += %d;\n", k);
+    else
+        fprintf(fp, "        as->pc = 0x%08x; return n + %d;\n",
+                base + last * 4, k);
+}
+
+/**********************************************************************/
+int Mips2c::translate(char *binfile, char *outfile)
+{
+    if ((fp = fopen(outfile, "w")) == NULL) {
+        fprintf(stderr, "## can't open file: %s\n", outfile);
+        return 1;
+    }
+
+    uint032_t sum = 2166136261u;
+    for (uint032_t i = 0; i < ninst * 4; i++)
+        sum = (sum ^ ((inst[i / 4].ir >> (i % 4) * 8) & 0xff)) * 16777619u;
+
+    fprintf(fp, "/* generated by mips2c from %s: do not edit */\n", binfile);
+    fprintf(fp, "#include \"define.h\"\n\n");
+    fprintf(fp, "#pragma GCC diagnostic ignored \"-Wunused-label\"\n\n");
+    fprintf(fp, "static uint064_t run(MipsAot *x, MipsArchstate *as, "
+            "uint064_t limit)\n{\n");
+    fprintf(fp, "    uint032_t *r = as->r;\n");
+    fprintf(fp, "    uint064_t n = 0, t64;\n");
+    fprintf(fp, "    uint032_t t = 0, v;\n");
+    fprintf(fp, "    int c = 0, ok = 1;\n");
+    fprintf(fp, "    (void) t64; (void) c; (void) ok;\n\n");
+    fprintf(fp, " dispatch:\n");
+    fprintf(fp, "    switch (as->pc) {\n");
+    for (uint032_t i = 0; i < ninst; i++)
+        if (leader[i])
+            emitblock(i);
+    fprintf(fp, "    default:\n");
+    fprintf(fp, "        break;\n");
+    fprintf(fp, "    }\n");
+    fprintf(fp, "    return n;\n}\n\n");
+    fprintf(fp, "static MipsAotImage image = {\n");
+    fprintf(fp, "    \"%s\", 0x%08x, 0x%08x, 0x%08x, run,\n};\n\n",
+            binfile, base, ninst * 4, sum);
+    fprintf(fp, "int main(int argc, char *argv[])\n{\n");
+    fprintf(fp, "    return mips_aot_main(argc, argv, &image);\n}\n");
+    fclose(fp);
+    return 0;
+}
+
+/**********************************************************************/
+int main(int argc, char *argv[])
+{
+    if (argc != 3) {
+        printf("Usage: mips2c object_file_name output_file_name\n");
+        return 1;
+    }
+
+    Mips2c *m2c = new Mips2c();
+    int ret = (m2c->load(argv[1]) || m2c->translate(argv[1], argv[2]));
+    DELETE(m2c);
+    return ret;
+}
+
+/**********************************************************************/
@@ -2,6 +2,7 @@
  * SimMips: Simple Computer Simulator of MIPS    Arch Lab. TOKYO TECH *
  **********************************************************************/
 #include "define.h"
+#include <sys/mman.h>
 
 enum {
     FI_NONE = 0x0,
@@ -20,24 +21,31 @@ enum {
 /**********************************************************************/
 SimLoader::SimLoader()
 {
-    memtab = NULL;
+    image = NULL;
+    imagesize = 0;
+    segtab = NULL;
     symtab = NULL;
     fileident = FI_NONE;
     filetype = 0;
     endian = 0;
     archtype = 0;
-    memtabnum = 0;
+    segtabnum = 0;
     symtabnum = 0;
     entry = 0;
     stackptr = 0;
+    textbase = textsize = 0;
     dynamic = 0;
 }
 
 SimLoader::~SimLoader()
 {
-    if (memtab != NULL) {
-        delete [] memtab;
-        memtab = NULL;
+    if (segtab != NULL) {
+        delete [] segtab;
+        segtab = NULL;
+    }
+    if (image != NULL) {
+        munmap(image, imagesize);
+        image = NULL;
     }
     if (symtab != NULL) {
         for (int i = 0; i < symtabnum; i++)
@@ -100,6 +108,7 @@ int SimLoader::checkfile(const char *file)
 int SimLoader::loadelf32(const char *file)
 {
     Elf32_Ehdr *ehdr;
+    Elf32_Phdr *phdr;
     Elf32_Shdr *shdr, *shstr, *str = NULL, *sym = NULL;
     Elf32_Sym *symp;
     
@@ -109,8 +118,16 @@ int SimLoader::loadelf32(const char *file)
     archtype = ehdr->e_machine;
     entry = ehdr->e_entry;
     
+    /* read Program Header, the image is loaded a segment at a time */
+    segtabnum = 0;
+    for (int i = 0; i < ehdr->e_phnum; i++) {
+        phdr = (Elf32_Phdr *)(file + ehdr->e_phoff +
+                              ehdr->e_phentsize * i);
+        if ((phdr->p_type == PT_LOAD) && (phdr->p_memsz))
+            segtabnum++;
+    }
+
     /* read Section Header */
-    memtabnum = 0;
     shstr = (Elf32_Shdr *)(file + ehdr->e_shoff +
                            ehdr->e_shentsize * ehdr->e_shstrndx);
     for (int i = 0; i < ehdr->e_shnum; i++) {
@@ -125,8 +142,16 @@ int SimLoader::loadelf32(const char *file)
             sym = shdr;
         if (shdr->sh_type == SHT_DYNAMIC)
             dynamic = 1;
-        if (shdr->sh_flags & SHF_ALLOC) {
-            memtabnum += shdr->sh_size;
+        if ((!ehdr->e_phnum) && (shdr->sh_flags & SHF_ALLOC) &&
+            (shdr->sh_size))
+            segtabnum++;
+        if ((shdr->sh_flags & SHF_EXECINSTR) && (shdr->sh_size)) {
+            uint032_t end = textbase + textsize;
+            if ((!textsize) || (shdr->sh_addr < textbase))
+                textbase = shdr->sh_addr;
+            if ((!textsize) || (shdr->sh_addr + shdr->sh_size > end))
+                end = shdr->sh_addr + shdr->sh_size;
+            textsize = end - textbase;
         }
     }
     
@@ -142,20 +167,38 @@ int SimLoader::loadelf32(const char *file)
         }
     }
 
-    /* write to memtab */
-    memtab = new memtab_t[memtabnum];
+    /* write to segtab, from the sections if there is no segment */
+    segtab = new segtab_t[segtabnum];
     int count = 0;
-    for (int i = 0; i < ehdr->e_shnum; i++) {
+    for (int i = 0; i < ehdr->e_phnum; i++) {
+        phdr = (Elf32_Phdr *)(file + ehdr->e_phoff +
+                              ehdr->e_phentsize * i);
+        if ((phdr->p_type != PT_LOAD) || (!phdr->p_memsz))
+            continue;
+        if ((phdr->p_offset > imagesize) ||
+            (phdr->p_filesz > imagesize - phdr->p_offset) ||
+            (phdr->p_filesz > phdr->p_memsz)) {
+            fprintf(stderr, "## ERROR: broken segment at 0x%08x.\n",
+                    phdr->p_vaddr);
+            return(1);
+        }
+        segtab[count].addr = phdr->p_vaddr;
+        segtab[count].filesize = phdr->p_filesz;
+        segtab[count].memsize = phdr->p_memsz;
+        segtab[count].data = (uint008_t *)(file + phdr->p_offset);
+        count++;
+    }
+    for (int i = 0; (!ehdr->e_phnum) && (i < ehdr->e_shnum); i++) {
         shdr = (Elf32_Shdr *)(file + ehdr->e_shoff +
                               ehdr->e_shentsize * i);
-        if (shdr->sh_flags & SHF_ALLOC) {
-            for(unsigned int j = 0; j < shdr->sh_size; j++) {
-                memtab[count].addr = shdr->sh_addr + j;
-                memtab[count].data = (shdr->sh_type & SHT_NOBITS) ? 0 :
-                    *(uint008_t *)(file + shdr->sh_offset + j);
-                count++;
-            }
-        }
+        if ((!(shdr->sh_flags & SHF_ALLOC)) || (!shdr->sh_size))
+            continue;
+        segtab[count].addr = shdr->sh_addr;
+        segtab[count].filesize = (shdr->sh_type == SHT_NOBITS) ? 0 :
+            shdr->sh_size;
+        segtab[count].memsize = shdr->sh_size;
+        segtab[count].data = (uint008_t *)(file + shdr->sh_offset);
+        count++;
     }
     
     /* write to symtab */
@@ -192,19 +235,25 @@ int SimLoader::loadfile(char *filename)
     struct stat sb;
     char *file;
     
-    /* open and read file */
+    /* open and map file, segments point into it until deleted;
+       writable as a private copy, so that guest pages can share it */
     fd = open(filename, O_RDONLY);
     if (fd == -1) {
         fprintf(stderr, "## ERROR: Can't open file. (%s)\n", filename);
         return(1);
     }
     fstat(fd, &sb);
-    file = new char[sb.st_size];
-    if (read(fd, file, sb.st_size) < sb.st_size) {
+    file = (sb.st_size >= EI_NIDENT) ?
+        (char *) mmap(NULL, sb.st_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE, fd, 0) :
+        (char *) MAP_FAILED;
+    close(fd);
+    if (file == MAP_FAILED) {
         fprintf(stderr, "## ERROR: Can't read file. (%s)\n", filename);
         return(1);
     }
-    close(fd);
+    image = file;
+    imagesize = sb.st_size;
     if (checkfile(file))
         return(1);
     
@@ -219,9 +268,18 @@ int SimLoader::loadfile(char *filename)
         return(1);
         break;
     }
-    delete [] file;
-    file = NULL;
     return(0);
 }
 
 /**********************************************************************/
+char *SimLoader::detach(size_t *size)
+{
+    /* the caller unmaps the file, segments stay valid until then */
+    char *file = image;
+    *size = imagesize;
+    image = NULL;
+    imagesize = 0;
+    return(file);
+}
+
+/**********************************************************************/
@@ -0,0 +1,335 @@
+/**********************************************************************
+ * SimMips: Simple Computer Simulator of MIPS    Arch Lab. TOKYO TECH *
+ **********************************************************************/
+#include "define.h"
+#include <math.h>
+
+/* simpoint picks the representative intervals of a run from the basic
+ * block vectors written by "SimMips -v".  The vectors, normalized, are
+ * projected at random down to SP_DIM dimensions and clustered by
+ * k-means for k from 1 up to the maximum.  The smallest k whose BIC
+ * reaches 90% of the range seen is taken, and the interval nearest to
+ * the center of each cluster stands for it, weighted by its size.  The
+ * output, for "SimPipe -simpoint", is "interval weight" a line after a
+ * header of "# interval num" and "# insts num". */
+
+enum {
+    SP_DIM = 15,               // dimensions projected down to
+    SP_MAXK_DEF = 10,
+    SP_SEEDS = 5,              // k-means runs for each k
+    SP_ITER = 100,
+};
+
+/**********************************************************************/
+class SimPoint {
+ private:
+    int npoint, maxk;
+    ullint interval, insts;
+    double (*point)[SP_DIM];
+    int *cluster, *best;
+    uint064_t seed;
+
+    double random();
+    double project(uint032_t, int);
+    double distance(const double *, const double *);
+    double kmeans(int, int *);
+    double bic(int, int *, double);
+
+ public:
+    SimPoint(int);
+    ~SimPoint();
+    int load(const char *);
+    int pick(const char *);
+};
+
+/**********************************************************************/
+SimPoint::SimPoint(int maxk)
+{
+    npoint = 0;
+    this->maxk = maxk;
+    interval = insts = 0;
+    point = NULL;
+    cluster = best = NULL;
+    seed = 1;
+}
+
+/**********************************************************************/
+SimPoint::~SimPoint()
+{
+    DELETE_ARRAY(point);
+    DELETE_ARRAY(cluster);
+    DELETE_ARRAY(best);
+}
+
+/**********************************************************************/
+double SimPoint::random()
+{
+    // a fixed sequence, so that the same vectors give the same points
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    return (double) (seed >> 11) / (double) (1ull << 53);
+}
+
+/**********************************************************************/
+double SimPoint::project(uint032_t id, int dim)
+{
+    // the projection matrix is a hash of the block id, not stored
+    uint064_t h = ((uint064_t) id << 8 | dim) * 0x9e3779b97f4a7c15ull;
+    h ^= h >> 29;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 32;
+    return (double) (h >> 11) / (double) (1ull << 52) - 1.0;
+}
+
+/**********************************************************************/
+double SimPoint::distance(const double *a, const double *b)
+{
+    double d = 0;
+    for (int i = 0; i < SP_DIM; i++)
+        d += (a[i] - b[i]) * (a[i] - b[i]);
+    return d;
+}
+
+/**********************************************************************/
+int SimPoint::load(const char *filename)
+{
+    FILE *fp;
+    if ((fp = fopen(filename, "r")) == NULL) {
+        fprintf(stderr, "## can't open bbv file: %s\n", filename);
+        return 1;
+    }
+
+    int c, size = 0;
+    while ((c = getc(fp)) != EOF)
+        if (c == 'T')
+            size++;
+    rewind(fp);
+    if (fscanf(fp, "# interval %llu", &interval) != 1) {
+        fprintf(stderr, "## not a bbv file: %s\n", filename);
+        fclose(fp);
+        return 1;
+    }
+    point = new double[size][SP_DIM];
+
+    // a vector, normalized to the insts of its interval, is projected
+    while ((c = getc(fp)) != EOF) {
+        if (c != 'T')
+            continue;
+        double *p = point[npoint++];
+        double total = 0;
+        uint032_t id;
+        ullint count;
+        for (int i = 0; i < SP_DIM; i++)
+            p[i] = 0;
+        while (fscanf(fp, " :%u:%llu", &id, &count) == 2) {
+            total += count;
+            for (int i = 0; i < SP_DIM; i++)
+                p[i] += count * project(id, i);
+        }
+        for (int i = 0; (total > 0) && (i < SP_DIM); i++)
+            p[i] /= total;
+        insts += (ullint) total;
+    }
+    fclose(fp);
+    if (!npoint) {
+        fprintf(stderr, "## no vector in bbv file: %s\n", filename);
+        return 1;
+    }
+    cluster = new int[npoint];
+    best = new int[npoint];
+    return 0;
+}
+
+/**********************************************************************/
+double SimPoint::kmeans(int k, int *member)
+{
+    // k-means++ seeding, then Lloyd's iterations up to SP_ITER
+    double (*center)[SP_DIM] = new double[k][SP_DIM];
+    double *dist = new double[npoint];
+    int *size = new int[k];
+
+    memcpy(center[0], point[(int) (random() * npoint)], sizeof(center[0]));
+    for (int i = 0; i < npoint; i++)
+        dist[i] = distance(point[i], center[0]);
+    for (int j = 1; j < k; j++) {
+        double sum = 0;
+        for (int i = 0; i < npoint; i++)
+            sum += dist[i];
+        double r = random() * sum;
+        int pick = npoint - 1;
+        for (int i = 0; i < npoint; i++)
+            if ((r -= dist[i]) < 0) {
+                pick = i;
+                break;
+            }
+        memcpy(center[j], point[pick], sizeof(center[j]));
+        for (int i = 0; i < npoint; i++) {
+            double d = distance(point[i], center[j]);
+            if (d < dist[i])
+                dist[i] = d;
+        }
+    }
+
+    double sse = 0;
+    for (int iter = 0; iter < SP_ITER; iter++) {
+        int changed = 0;
+        sse = 0;
+        for (int i = 0; i < npoint; i++) {
+            int m = 0;
+            double dmin = distance(point[i], center[0]);
+            for (int j = 1; j < k; j++) {
+                double d = distance(point[i], center[j]);
+                if (d < dmin) {
+                    dmin = d;
+                    m = j;
+                }
+            }
+            if ((iter == 0) || (member[i] != m))
+                changed = 1;
+            member[i] = m;
+            sse += dmin;
+        }
+        if (!changed)
+            break;
+        for (int j = 0; j < k; j++) {
+            size[j] = 0;
+            for (int d = 0; d < SP_DIM; d++)
+                center[j][d] = 0;
+        }
+        for (int i = 0; i < npoint; i++) {
+            size[member[i]]++;
+            for (int d = 0; d < SP_DIM; d++)
+                center[member[i]][d] += point[i][d];
+        }
+        for (int j = 0; j < k; j++)
+            for (int d = 0; (size[j]) && (d < SP_DIM); d++)
+                center[j][d] /= size[j];
+    }
+
+    DELETE_ARRAY(center);
+    DELETE_ARRAY(dist);
+    DELETE_ARRAY(size);
+    return sse;
+}
+
+/**********************************************************************/
+double SimPoint::bic(int k, int *member, double sse)
+{
+    // the spherical gaussian model of x-means, as SimPoint scores it
+    double r = npoint;
+    double variance = (npoint > k) ? sse / (r - k) : 0;
+    if (variance <= 0)
+        variance = 1e-300;
+    int *size = new int[k];
+    for (int j = 0; j < k; j++)
+        size[j] = 0;
+    for (int i = 0; i < npoint; i++)
+        size[member[i]]++;
+
+    double likelihood = 0;
+    for (int j = 0; j < k; j++) {
+        double n = size[j];
+        if (n <= 0)
+            continue;
+        likelihood += n * log(n) - n * log(r) - n / 2.0 * log(2 * M_PI)
+            - n * SP_DIM / 2.0 * log(variance) - (n - k) / 2.0;
+    }
+    DELETE_ARRAY(size);
+    double params = (k - 1) + SP_DIM * k + 1;
+    return likelihood - params / 2.0 * log(r);
+}
+
+/**********************************************************************/
+int SimPoint::pick(const char *filename)
+{
+    int kmax = (maxk < npoint) ? maxk : npoint;
+    double *score = new double[kmax + 1];
+    int **members = new int *[kmax + 1];
+
+    for (int k = 1; k <= kmax; k++) {
+        double bestsse = -1;
+        members[k] = new int[npoint];
+        for (int s = 0; s < SP_SEEDS; s++) {
+            double sse = kmeans(k, cluster);
+            if ((bestsse < 0) || (sse < bestsse)) {
+                bestsse = sse;
+                memcpy(members[k], cluster, sizeof(int) * npoint);
+            }
+        }
+        score[k] = bic(k, members[k], bestsse);
+    }
+
+    double smin = score[1], smax = score[1];
+    for (int k = 2; k <= kmax; k++) {
+        if (score[k] < smin) smin = score[k];
+        if (score[k] > smax) smax = score[k];
+    }
+    int k = 1;
+    while ((k < kmax) && (score[k] < smin + 0.9 * (smax - smin)))
+        k++;
+    memcpy(best, members[k], sizeof(int) * npoint);
+    for (int j = 1; j <= kmax; j++)
+        DELETE_ARRAY(members[j]);
+    DELETE_ARRAY(members);
+    DELETE_ARRAY(score);
+
+    // the member nearest to the center of each cluster stands for it
+    FILE *fp;
+    if ((fp = fopen(filename, "w")) == NULL) {
+        fprintf(stderr, "## can't open output file: %s\n", filename);
+        return 1;
+    }
+    fprintf(fp, "# interval %llu\n# insts %llu\n", interval, insts);
+    printf("## %d intervals of %llu insts, %d clusters\n",
+           npoint, interval, k);
+    for (int j = 0; j < k; j++) {
+        double center[SP_DIM] = {0};
+        int n = 0;
+        for (int i = 0; i < npoint; i++)
+            if (best[i] == j) {
+                n++;
+                for (int d = 0; d < SP_DIM; d++)
+                    center[d] += point[i][d];
+            }
+        if (!n)
+            continue;
+        for (int d = 0; d < SP_DIM; d++)
+            center[d] /= n;
+        int rep = -1;
+        double dmin = 0;
+        for (int i = 0; i < npoint; i++) {
+            if (best[i] != j)
+                continue;
+            double d = distance(point[i], center);
+            if ((rep < 0) || (d < dmin)) {
+                dmin = d;
+                rep = i;
+            }
+        }
+        fprintf(fp, "%d %f\n", rep, (double) n / npoint);
+        printf("## interval %d, weight %f\n", rep, (double) n / npoint);
+    }
+    fclose(fp);
+    return 0;
+}
+
+/**********************************************************************/
+int main(int argc, char *argv[])
+{
+    int maxk = SP_MAXK_DEF;
+    if ((argc == 5) && (strcmp(argv[1], "-k") == 0)) {
+        maxk = atoi(argv[2]);
+        argc -= 2;
+        argv += 2;
+    }
+    if ((argc != 3) || (maxk < 1)) {
+        printf("Usage: simpoint [-k max_clusters] bbv_file output_file\n");
+        return 1;
+    }
+
+    SimPoint *sp = new SimPoint(maxk);
+    int ret = (sp->load(argv[1]) || sp->pick(argv[2]));
+    DELETE(sp);
+    return ret;
+}
+
+/**********************************************************************/
@@ -0,0 +1,201 @@
+/**********************************************************************
+ * SimMips: Simple Computer Simulator of MIPS    Arch Lab. TOKYO TECH *
+ **********************************************************************/
+#include "define.h"
+#include <zlib.h>
+
+#define TRACE_HEADER "SimMips_Trace_1"
+
+/* An inst trace holds what a pipeline model needs of each inst run.
+ * A record is a flag byte, then only what can't be guessed: the pc if
+ * it is not the next one, the decoded fields if they differ from the
+ * ones last seen at that pc, and the paddr of a load or store as the
+ * difference from the last one.  Numbers are zigzag varints.  The
+ * records go through a buffer of TRACE_BUF bytes into one gzip stream. */
+
+enum {
+    TR_JUMP = 0x01,          // the pc follows
+    TR_STATIC = 0x02,        // op, attr, rs, rt and rd follow
+    TR_NOCOUNT = 0x04,       // not counted as an inst (an exception)
+    TR_END = 0x80,
+    TR_MAXREC = 32,          // bytes of a record at most
+};
+
+/**********************************************************************/
+InstTrace::InstTrace()
+{
+    fp = NULL;
+    error = 0;
+    write = 0;
+    pos = len = 0;
+    pc = 0;
+    paddr = 0;
+    buf = new uint008_t[TRACE_BUF];
+    table = new traceinst_t[TRACE_TABLE];
+    for (int i = 0; i < TRACE_TABLE; i++)
+        table[i].pc = 1; // never an inst address
+}
+
+/**********************************************************************/
+InstTrace::~InstTrace()
+{
+    if (fp) {
+        if (write) {
+            buf[pos++] = TR_END;
+            flush();
+        }
+        gzclose((gzFile) fp);
+    }
+    DELETE_ARRAY(buf);
+    DELETE_ARRAY(table);
+}
+
+/**********************************************************************/
+int InstTrace::open(const char *filename, int write)
+{
+    char header[sizeof(TRACE_HEADER)];
+    this->write = write;
+    if ((fp = gzopen(filename, (write) ? "wb1" : "rb")) == NULL) {
+        fprintf(stderr, "## can't open trace: %s\n", filename);
+        return 1;
+    }
+    if (write) {
+        memcpy(buf, TRACE_HEADER, sizeof(TRACE_HEADER));
+        pos = sizeof(TRACE_HEADER);
+    } else if ((gzread((gzFile) fp, header, sizeof(header)) !=
+                (int) sizeof(header)) ||
+               (memcmp(header, TRACE_HEADER, sizeof(header)))) {
+        fprintf(stderr, "## not a trace: %s\n", filename);
+        return 1;
+    }
+    return 0;
+}
+
+/**********************************************************************/
+void InstTrace::flush()
+{
+    if ((!error) && (pos) &&
+        (gzwrite((gzFile) fp, buf, pos) != (int) pos))
+        error = 1;
+    pos = 0;
+}
+
+/**********************************************************************/
+void InstTrace::fill()
+{
+    // the bytes not read yet are moved to the head of the buffer
+    memmove(buf, buf + pos, len - pos);
+    len -= pos;
+    pos = 0;
+    int n = gzread((gzFile) fp, buf + len, TRACE_BUF - len);
+    if (n > 0)
+        len += n;
+}
+
+/**********************************************************************/
+inline void InstTrace::putvar(uint064_t v)
+{
+    while (v >= 0x80) {
+        buf[pos++] = (uint008_t) (v | 0x80);
+        v >>= 7;
+    }
+    buf[pos++] = (uint008_t) v;
+}
+
+/**********************************************************************/
+inline uint064_t InstTrace::getvar()
+{
+    uint064_t v = 0;
+    for (int shift = 0; (pos < len) && (shift < 64); shift += 7) {
+        uint008_t b = buf[pos++];
+        v |= (uint064_t) (b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return v;
+    }
+    error = 1;
+    return 0;
+}
+
+/**********************************************************************/
+void InstTrace::put(const traceinst_t *ti)
+{
+    traceinst_t *e = &table[(ti->pc >> 2) & (TRACE_TABLE - 1)];
+    int flag = 0;
+    if (ti->pc != pc + 4)
+        flag |= TR_JUMP;
+    if ((e->pc != ti->pc) || (e->op != ti->op) || (e->attr != ti->attr) ||
+        (e->rs != ti->rs) || (e->rt != ti->rt) || (e->rd != ti->rd)) {
+        flag |= TR_STATIC;
+        *e = *ti;
+    }
+    if (!ti->counted)
+        flag |= TR_NOCOUNT;
+
+    if (pos + TR_MAXREC > TRACE_BUF)
+        flush();
+    buf[pos++] = (uint008_t) flag;
+    if (flag & TR_JUMP) {
+        int032_t d = (int032_t) (ti->pc - (pc + 4));
+        putvar((uint032_t) ((d << 1) ^ (d >> 31)));
+    }
+    if (flag & TR_STATIC) {
+        putvar(ti->op);
+        putvar(ti->attr);
+        buf[pos++] = ti->rs;
+        buf[pos++] = ti->rt;
+        buf[pos++] = ti->rd;
+    }
+    if (ti->attr & LOADSTORE) {
+        int064_t d = (int064_t) (ti->paddr - paddr);
+        putvar((uint064_t) ((d << 1) ^ (d >> 63)));
+        paddr = ti->paddr;
+    }
+    pc = ti->pc;
+}
+
+/**********************************************************************/
+int InstTrace::get(traceinst_t *ti)
+{
+    if ((error) || (write))
+        return 0;
+    if (pos + TR_MAXREC > len)
+        fill();
+    if (pos >= len) {
+        error = 1; // cut short, without the end mark
+        return 0;
+    }
+    int flag = buf[pos++];
+    if (flag & TR_END)
+        return 0;
+
+    uint032_t newpc = pc + 4;
+    if (flag & TR_JUMP) {
+        uint032_t z = (uint032_t) getvar();
+        newpc += (z >> 1) ^ -(z & 1);
+    }
+    traceinst_t *e = &table[(newpc >> 2) & (TRACE_TABLE - 1)];
+    if (flag & TR_STATIC) {
+        e->pc = newpc;
+        e->op = (uint032_t) getvar();
+        e->attr = (uint) getvar();
+        if (pos + 3 > len) {
+            error = 1;
+            return 0;
+        }
+        e->rs = buf[pos++];
+        e->rt = buf[pos++];
+        e->rd = buf[pos++];
+    }
+    *ti = *e;
+    ti->pc = newpc;
+    ti->counted = !(flag & TR_NOCOUNT);
+    if (ti->attr & LOADSTORE) {
+        uint064_t z = getvar();
+        paddr += (z >> 1) ^ -(z & 1);
+    }
+    ti->paddr = paddr;
+    pc = newpc;
+    return !error;
+}
+
+/**********************************************************************/
@@ -4,6 +4,7 @@
  */
 
 #include  <cassert>
+#include  <cstring>
 #include  "cache.h"
 
 #undef  DEBUG_CACHE
@@ -39,6 +40,61 @@ calc_mask_bits(uint032_t mask)
     return i;
 }
 
+BlockSet::BlockSet()
+    : table_size(TABLE_INIT), pages(0), last_pageno(0), last_bits(NULL)
+{
+    table = new Entry[table_size];
+    memset(table, 0, sizeof(Entry)*table_size);
+}
+
+BlockSet::~BlockSet()
+{
+    for (uint032_t i = 0; i < table_size; i++) {
+	delete[]  table[i].bits;
+    }
+    delete[]  table;
+}
+
+BlockSet::Entry*
+BlockSet::Find(Entry* t, uint032_t size, uint064_t pageno)
+{
+    uint032_t  i = (uint032_t)((pageno * 0x9e3779b97f4a7c15ULL) >> 32)
+	& (size - 1);
+    while (t[i].bits != NULL && t[i].pageno != pageno) {
+	i = (i + 1) & (size - 1);
+    }
+    return  &t[i];
+}
+
+uint064_t*
+BlockSet::Page(uint064_t pageno)
+{
+    Entry*  e = Find(table, table_size, pageno);
+    if (e->bits != NULL) {
+	return  e->bits;
+    }
+    /* the table is kept at most half full */
+    if ((pages+1)*2 > table_size) {
+	Entry*  old = table;
+	uint032_t  old_size = table_size;
+	table_size *= 2;
+	table = new Entry[table_size];
+	memset(table, 0, sizeof(Entry)*table_size);
+	for (uint032_t i = 0; i < old_size; i++) {
+	    if (old[i].bits != NULL) {
+		*Find(table, table_size, old[i].pageno) = old[i];
+	    }
+	}
+	delete[]  old;
+	e = Find(table, table_size, pageno);
+    }
+    e->pageno = pageno;
+    e->bits = new uint064_t[(1 << PAGE_BITS) / 64];
+    memset(e->bits, 0, sizeof(uint064_t) * ((1 << PAGE_BITS) / 64));
+    pages++;
+    return  e->bits;
+}
+
 Cache::Cache(uint032_t size, uint032_t way, uint032_t line, int penalty,
 	  bool writeback)
     : size(size), way(way), line(line), penalty(penalty), writeback(writeback),
@@ -85,8 +141,6 @@ Cache::Cache(uint032_t size, uint032_t way, uint032_t line, int penalty,
 	state[i] = 0;
 	lru_count[i] = 0;
     }
-
-    block_hist = new std::set<uint064_t>();
 }
 
 Cache::~Cache()
@@ -111,6 +165,15 @@ Cache::PutStatistics()
 	   conflict_count, (double)conflict_count/access_count);
 }
 
+void
+Cache::PutSummary(FILE* fp)
+{
+    /* one row of the table of a sweep */
+    fprintf(fp, " %10d %8.4f %10d %10d %10d",
+	    access_count, (double)hit_count/access_count,
+	    compulsory_count, capacity_count, conflict_count);
+}
+
 int
 Cache::Access(uint064_t address, int rwtype)
 {
@@ -148,10 +211,8 @@ Cache::Access(uint064_t address, int rwtype)
 	access_count--; /* Not a valid cache access */
     } else {
 	uint064_t  block_no = address >> offset_mask_bits;
-	std::set<uint064_t>::iterator sit = block_hist->find(block_no);
-	if (sit == block_hist->end()) {
+	if (block_hist.Insert(block_no)) {
 	    compulsory_count++;
-	    block_hist->insert(block_no);
 	} else {
 	    if (remained_lines > 0) {
 		conflict_count++;
@@ -10,7 +10,51 @@
 #include  "define.h"
 #endif
 
-#include  <set>
+/* the blocks ever brought in, a bit each in pages of a bitmap that
+   are found by a hash of the page number */
+class BlockSet {
+public:
+    BlockSet();
+    ~BlockSet();
+
+    /* true if the block is new to it */
+    bool Insert(uint064_t block) {
+	uint064_t  pageno = block >> PAGE_BITS;
+	if (last_bits == NULL || pageno != last_pageno) {
+	    last_bits = Page(pageno);
+	    last_pageno = pageno;
+	}
+	uint032_t  bit = (uint032_t)block & ((1 << PAGE_BITS) - 1);
+	uint064_t  mask = 1ULL << (bit & 63);
+	if (last_bits[bit >> 6] & mask) {
+	    return  false;
+	}
+	last_bits[bit >> 6] |= mask;
+	return  true;
+    }
+
+private:
+    enum { PAGE_BITS = 15 };   /* 32K blocks, 4KB, a page */
+    enum { TABLE_INIT = 64 };
+
+    /* not copied, as it owns the pages */
+    BlockSet(const BlockSet&);
+    BlockSet& operator=(const BlockSet&);
+
+    struct Entry {
+	uint064_t  pageno;
+	uint064_t*  bits; /* NULL if the entry is free */
+    };
+
+    uint064_t*  Page(uint064_t pageno);
+    Entry*  Find(Entry* table, uint032_t size, uint064_t pageno);
+
+    Entry*  table;
+    uint032_t  table_size;
+    uint032_t  pages;
+    uint064_t  last_pageno;
+    uint064_t*  last_bits;
+};
 
 class Cache {
 public:
@@ -23,6 +67,9 @@ public:
     int  Access(uint064_t address, int rwtype);
 
     void PutStatistics();
+    void PutSummary(FILE* fp);
+    int  AccessCount() const { return access_count; }
+    int  HitCount() const { return hit_count; }
 
 private:
     bool is_hit(uint064_t address, uint064_t& tag,
@@ -57,7 +104,7 @@ private:
     int  capacity_count;
     int  conflict_count;
     int  remained_lines;
-    std::set<uint064_t>* block_hist;
+    BlockSet  block_hist;
 };
 
 #endif	// CACHE_H
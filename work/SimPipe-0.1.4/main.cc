@@ -9,6 +9,7 @@ main(int argc, char** argv)
     if (p->PipeInit(argc, argv) == 0) {
 	p->ExecLoop();
     }
+    delete  p;
 
     return  0;
 }
@@ -4,8 +4,14 @@
  */
 
 #include  <cassert>
+#include  <cerrno>
 #include  <cstdlib>
 #include  <cstring>
+#include  <algorithm>
+#include  <fcntl.h>
+#include  <unistd.h>
+#include  <pthread.h>
+#include  <sys/wait.h>
 #include  "pipe.h"
 
 #undef  DEBUG_PIPELINE
@@ -14,26 +20,53 @@
 extern volatile sig_atomic_t recieve_int;
 
 PipeLine::PipeLine()
-    : cycle(0), forwarding(true), pipelog(false),
+    : cycle(0), warmup(0), inst_start(0), forwarding(true), pipelog(false),
+      sweep_fd(-1),
+      sample_period(0), sample_unit(DEFAULT_SAMPLE_UNIT),
+      sample_detail(DEFAULT_SAMPLE_DETAIL), sample_fwcache(false),
+      point_interval(0), point_insts(0),
       dcache_enable(false),
       dcache_size(DEFAULT_DCACHE_SIZE),
       dcache_way(DEFAULT_DCACHE_WAY),
       dcache_line(DEFAULT_DCACHE_LINE),
       dcache_penalty(DEFAULT_DCACHE_PENALTY),
-      dcache_writeback(DEFAULT_DCACHE_WRITEBACK)
+      dcache_writeback(DEFAULT_DCACHE_WRITEBACK),
+      logbin(NULL),
+      logbin_compress(false),
+      log_from(0),
+      log_to(~0ULL),
+      log_pc(0),
+      log_pc_span(0),
+      log_until(0),
+      log_head(0)
 {
     for (int i = 0; i < PIPE_DEPTH; i++) {
 	stage_state[i] = STAGE_IDLE;
 	stage_wait_cycle[i] = 0;
+	latches[i].uop = &idle_op;
     }
+    ring_head = 0;
+    board = NULL;
+    dcache = NULL;
+    mips = NULL;
+    trace_file = NULL;
+    trace = NULL;
+    trace_more = false;
+    trace_count = 0;
+    trace_records = 0;
+    feed = NULL;
 }
 
 PipeLine::~PipeLine()
 {
     delete  board;
-    if (dcache_enable) {
-	delete  dcache;
+    delete  trace;
+    delete  feed;
+    delete  logbin;
+    for (size_t i = 0; i < backends.size(); i++) {
+	delete  backends[i];
     }
+    delete  dcache;
 }
 
 int
@@ -42,18 +75,48 @@ PipeLine::PipeInit(int argc, char** argv)
     int bargc;
     char** bargv;
     bargv = CheckOpt(argc, argv, &bargc);
+    if ((sample_period > 0 || !points.empty()) && !sweep.empty()) {
+	fprintf(stderr, "-sample and -simpoint can't be used with -sweep\n");
+	return 1;
+    }
+    if (!backends.empty() && (!sweep.empty() || sample_period > 0
+			      || !points.empty() || pipelog)) {
+	fprintf(stderr, "-next can't be used with -sweep, -sample,"
+		" -simpoint or -l\n");
+	return 1;
+    }
+    if (sample_period > 0 && !points.empty()) {
+	fprintf(stderr, "-sample can't be used with -simpoint\n");
+	return 1;
+    }
+    if (sample_period > 0 && sample_period < sample_detail + sample_unit) {
+	fprintf(stderr, "Sampling period shorter than its detailed window\n");
+	return 1;
+    }
     PutConfig();
 
-    board = new Board();
-    int ret = board->siminit(bargc, bargv);
-    if (ret > 0) {
-	return ret;
-    }
-    mips = board->chip->mips;
-    for (int i = 0; i < PIPE_DEPTH; i++) {
-	latches[i].inst.op = 0;
+    int ret = 0;
+    if (trace_file) {
+	/* the trace stands for the whole of SimMips */
+	if (!OpenTrace(0)) {
+	    return 1;
+	}
+	inst_count = &trace_count;
+    } else {
+	board = new Board();
+	ret = board->siminit(bargc, bargv);
+	if (ret > 0) {
+	    return ret;
+	}
+	mips = board->chip->mips;
+	inst_count = &mips->ss->inst_count;
     }
-    if (pipelog) {
+    if (pipelog && logbin) {
+	if (!logbin->Open(PIPEBINNAME, logbin_compress)) {
+	    fprintf(stderr, "Can't open pipe-log file.\n");
+	    ret = 1;
+	}
+    } else if (pipelog) {
 	if ((logfd = fopen(PIPELOGNAME, "w")) == NULL) {
 	    fprintf(stderr, "Can't open pipe-log file.\n");
 	    ret = 1;
@@ -61,9 +124,34 @@ PipeLine::PipeInit(int argc, char** argv)
 	fprintf(logfd, "        |        |   F   |   D   |   E   |   M   |   W   |\n");
     }
 
-    dcache = new Cache(dcache_size, dcache_way, dcache_line,
-		       dcache_penalty, dcache_writeback);
+    /* with -next only the back-ends run a pipeline */
+    if (dcache_enable && backends.empty()) {
+	dcache = new Cache(dcache_size, dcache_way, dcache_line,
+			   dcache_penalty, dcache_writeback);
+    }
 
+    /* the first configuration is run as a back-end like the others */
+    if (!backends.empty()) {
+	PipeLine*  first = new PipeLine();
+	first->forwarding = forwarding;
+	first->dcache_enable = dcache_enable;
+	first->dcache_size = dcache_size;
+	first->dcache_way = dcache_way;
+	first->dcache_line = dcache_line;
+	first->dcache_penalty = dcache_penalty;
+	first->dcache_writeback = dcache_writeback;
+	backends.insert(backends.begin(), first);
+    }
+    for (size_t i = 0; i < backends.size(); i++) {
+	PipeLine*  b = backends[i];
+	b->feed = new OpRing();
+	b->inst_count = &b->trace_count;
+	if (b->dcache_enable) {
+	    b->dcache = new Cache(b->dcache_size, b->dcache_way,
+				  b->dcache_line, b->dcache_penalty,
+				  b->dcache_writeback);
+	}
+    }
 
     return  ret;
 }
@@ -79,6 +167,7 @@ PipeLine::CheckOpt(int argc, char** argv, int* bargc)
 
     bargv[(*bargc)++] = argv[0];
     char*  opt;
+    PipeLine*  cfg = this; /* -dcache and -f set the latest -next */
     for (int i = 1; (opt = argv[i]) != NULL; i++) {
 	if (opt[0] != '-') {
 	    bargv[(*bargc)++] = argv[i];
@@ -87,29 +176,29 @@ PipeLine::CheckOpt(int argc, char** argv, int* bargc)
 	switch (opt[1]) {
 	case  'd':
 	    if (strcmp(opt+2, "cache-size") == 0) {
-		dcache_enable = true;
-		dcache_size = atoi(argv[++i]) * 1024;
+		cfg->dcache_enable = true;
+		cfg->dcache_size = atoi(argv[++i]) * 1024;
 	    } else if (strcmp(opt+2, "cache-way") == 0) {
-		dcache_enable = true;
-		dcache_way = atoi(argv[++i]);
+		cfg->dcache_enable = true;
+		cfg->dcache_way = atoi(argv[++i]);
 	    } else if (strcmp(opt+2, "cache-line") == 0) {
-		dcache_enable = true;
-		dcache_line = atoi(argv[++i]);
+		cfg->dcache_enable = true;
+		cfg->dcache_line = atoi(argv[++i]);
 	    } else if (strcmp(opt+2, "cache-penalty") == 0) {
-		dcache_enable = true;
-		dcache_penalty = atoi(argv[++i]);
+		cfg->dcache_enable = true;
+		cfg->dcache_penalty = atoi(argv[++i]);
 	    } else if (strcmp(opt+2, "cache-writeback") == 0) {
-		dcache_enable = true;
-		dcache_writeback = atoi(argv[++i]);
+		cfg->dcache_enable = true;
+		cfg->dcache_writeback = atoi(argv[++i]);
 	    } else {
 		fprintf(stderr, "Invalid data cache parameter %s\n", opt);
 	    }
 	    break;
 	case  'f':
 	    if (opt[2] == '0') {
-		forwarding = false;
+		cfg->forwarding = false;
 	    } else if (opt[2] == '1') {
-		forwarding = true;
+		cfg->forwarding = true;
 	    } else {
 		fprintf(stderr, "Invalid forwarding parameter %c\n", opt[2]);
 	    }
@@ -119,7 +208,72 @@ PipeLine::CheckOpt(int argc, char** argv, int* bargc)
 	    bargv[(*bargc)++] = argv[i];
 	    break;
 	case  'l':
-	    pipelog = true;
+	    if (opt[2] == '\0') {
+		pipelog = true;
+	    } else if (strcmp(opt+2, "b") == 0 || strcmp(opt+2, "bz") == 0) {
+		pipelog = true;
+		logbin_compress = (opt[3] == 'z');
+		if (logbin == NULL) {
+		    logbin = new LogWriter();
+		}
+	    } else if (strcmp(opt+2, "og-window") == 0
+		       && argv[i+1] != NULL && argv[i+2] != NULL) {
+		pipelog = true;
+		log_from = strtoull(argv[++i], NULL, 0);
+		log_to = strtoull(argv[++i], NULL, 0);
+	    } else if (strcmp(opt+2, "og-pc") == 0
+		       && argv[i+1] != NULL && argv[i+2] != NULL) {
+		pipelog = true;
+		log_pc = strtoul(argv[++i], NULL, 16);
+		log_pc_span = strtoull(argv[++i], NULL, 0);
+	    } else {
+		bargv[(*bargc)++] = argv[i];
+	    }
+	    break;
+	case  's':
+	    if (strcmp(opt+2, "ample-fwcache") == 0) {
+		sample_fwcache = true;
+	    } else if (argv[i+1] == NULL) {
+		bargv[(*bargc)++] = argv[i];
+	    } else if (strcmp(opt+2, "weep") == 0) {
+		if (!ReadSweep(argv[++i])) {
+		    exit(1);
+		}
+	    } else if (strcmp(opt+2, "impoint") == 0) {
+		if (!ReadSimpoint(argv[++i])) {
+		    exit(1);
+		}
+	    } else if (strcmp(opt+2, "ample") == 0) {
+		sample_period = strtoull(argv[++i], NULL, 0);
+	    } else if (strcmp(opt+2, "ample-unit") == 0) {
+		sample_unit = strtoull(argv[++i], NULL, 0);
+	    } else if (strcmp(opt+2, "ample-detail") == 0) {
+		sample_detail = strtoull(argv[++i], NULL, 0);
+	    } else {
+		bargv[(*bargc)++] = argv[i];
+	    }
+	    break;
+	case  'n':
+	    if (strcmp(opt+2, "ext") != 0) {
+		bargv[(*bargc)++] = argv[i];
+	    } else {
+		cfg = new PipeLine();
+		backends.push_back(cfg);
+	    }
+	    break;
+	case  't':
+	    if (strcmp(opt+2, "race") != 0 || argv[i+1] == NULL) {
+		bargv[(*bargc)++] = argv[i];
+	    } else {
+		trace_file = argv[++i];
+	    }
+	    break;
+	case  'w':
+	    if (strcmp(opt+2, "armup") != 0 || argv[i+1] == NULL) {
+		bargv[(*bargc)++] = argv[i];
+	    } else {
+		warmup = strtoull(argv[++i], NULL, 0);
+	    }
 	    break;
 	default:
 	    bargv[(*bargc)++] = argv[i];
@@ -130,9 +284,8 @@ PipeLine::CheckOpt(int argc, char** argv, int* bargc)
 }
 
 void
-PipeLine::PutConfig()
+PipeLine::PutPipeConfig()
 {
-    printf("* Pipeline Configuration *\n");
     printf("  Forwarding: %s\n", forwarding ? "Yes" : "No");
     if (dcache_enable) {
 	printf("  DataCache Enabled\n");
@@ -144,6 +297,54 @@ PipeLine::PutConfig()
     } else {
 	printf("  DataCache Disabled\n");
     }
+}
+
+void
+PipeLine::PutConfig()
+{
+    printf("* Pipeline Configuration *\n");
+    if (backends.empty()) {
+	PutPipeConfig();
+    } else {
+	/* this one is the first of the -next configurations */
+	int  n = (int)backends.size() + 1;
+	printf(" Configuration 1 of %d\n", n);
+	PutPipeConfig();
+	for (size_t i = 0; i < backends.size(); i++) {
+	    printf(" Configuration %d of %d\n", (int)i + 2, n);
+	    backends[i]->PutPipeConfig();
+	}
+    }
+    if (warmup > 0) {
+	printf("  Warm-up:   %lld cycles\n", warmup);
+    }
+    if (!sweep.empty()) {
+	printf("  Sweep:     %d configurations\n", (int)sweep.size());
+    }
+    if (sample_period > 0) {
+	printf("  Sampling:  %lld insts every %lld insts"
+	       " after %lld in detail\n",
+	       sample_unit, sample_period, sample_detail);
+	printf("   Fast-forward warms DataCache: %s\n",
+	       sample_fwcache ? "Yes" : "No");
+    }
+    if (trace_file) {
+	printf("  Trace:     %s\n", trace_file);
+    }
+    if (pipelog && (log_from > 0 || log_to != ~0ULL)) {
+	printf("  Log:       cycles %lld to %lld\n", log_from, log_to);
+    }
+    if (log_pc_span > 0) {
+	printf("  Log:       %lld cycles from each fetch of %x\n",
+	       log_pc_span, log_pc);
+    }
+    if (!points.empty()) {
+	printf("  SimPoints: %d intervals of %lld insts"
+	       " after %lld in detail\n",
+	       (int)points.size(), point_interval, sample_detail);
+	printf("   Fast-forward warms DataCache: %s\n",
+	       sample_fwcache ? "Yes" : "No");
+    }
     printf("\n");
 }
 
@@ -157,46 +358,551 @@ PipeLine::help()
 	   " -dcache-penalty [num]: Data cache miss penalty cycles\n"
 	   " -dcache-writeback [01]: Data cache write-back [1] or write-through [1]\n"
 	   " -f[01]: Disable forwarding [0] or Enable forwarding [1]\n"
-	   " -l : Output pipeline log file\n");
+	   " -l : Output pipeline log file\n"
+	   " -lb : Output the log in binary to " PIPEBINNAME ", written in a thread;\n"
+	   "       read it with pipeview\n"
+	   " -lbz : Same as -lb, compressed in the thread\n"
+	   " -log-window [from] [to]: Log only the cycles from..to\n"
+	   " -log-pc [hex] [num]: Log only num cycles from each fetch of pc\n"
+	   " -warmup [num]: Run num cycles functionally before the pipeline\n"
+	   " -sweep [file]: Run the data cache configurations in file,\n"
+	   "                \"size way line penalty [writeback]\" a line,\n"
+	   "                in parallel after the warm-up\n"
+	   " -sample [num]: Sample the pipeline once every num insts,\n"
+	   "                fast-forwarding functionally in between\n"
+	   " -sample-unit [num]: Insts measured a sample (default 1000)\n"
+	   " -sample-detail [num]: Insts run in detail before it (default 2000)\n"
+	   " -sample-fwcache: Keep the data cache warm while fast-forwarding\n"
+	   " -simpoint [file]: Simulate only the intervals picked by\n"
+	   "                   SimMips/simpoint, fast-forwarding in between;\n"
+	   "                   -sample-detail and -sample-fwcache apply\n"
+	   " -trace [file]: Replay a trace written by SimMips -T instead of\n"
+	   "                running a program\n"
+	   " -next: Start another set of -dcache and -f options; all the sets\n"
+	   "        are run side by side in threads from one functional run\n");
+}
+
+bool
+PipeLine::OpenTrace(unsigned long long skip)
+{
+    /* a child of a sweep reads on from where its parent was */
+    delete  trace;
+    trace = new InstTrace();
+    if (trace->open(trace_file, 0)) {
+	return false;
+    }
+    trace_more = trace->get(&trace_next);
+    for (trace_records = 1; trace_records < skip && trace_more;
+	 trace_records++) {
+	trace_more = trace->get(&trace_next);
+    }
+    return true;
+}
+
+bool
+PipeLine::ReadSimpoint(const char* filename)
+{
+    FILE*  fp;
+    char  buf[256];
+
+    if ((fp = fopen(filename, "r")) == NULL) {
+	fprintf(stderr, "Can't open simpoint file %s\n", filename);
+	return false;
+    }
+    while (fgets(buf, sizeof(buf), fp) != NULL) {
+	unsigned long long  interval;
+	double  weight;
+	if (sscanf(buf, "# interval %llu", &point_interval) == 1
+	    || sscanf(buf, "# insts %llu", &point_insts) == 1
+	    || buf[strspn(buf, " \t\r\n")] == '\0' || buf[0] == '#') {
+	    continue;
+	}
+	if (sscanf(buf, "%llu %lf", &interval, &weight) != 2) {
+	    fprintf(stderr, "Invalid simpoint line: %s", buf);
+	    fclose(fp);
+	    return false;
+	}
+	points.push_back(PhasePoint(interval, weight));
+    }
+    fclose(fp);
+    if (point_interval == 0 || points.empty()) {
+	fprintf(stderr, "No interval in simpoint file %s\n", filename);
+	return false;
+    }
+    std::sort(points.begin(), points.end());
+    return true;
+}
+
+bool
+PipeLine::ReadSweep(const char* filename)
+{
+    FILE*  fp;
+    char  buf[256];
+
+    if ((fp = fopen(filename, "r")) == NULL) {
+	fprintf(stderr, "Can't open sweep file %s\n", filename);
+	return false;
+    }
+    while (fgets(buf, sizeof(buf), fp) != NULL) {
+	unsigned int  size, way, line, writeback = DEFAULT_DCACHE_WRITEBACK;
+	int  penalty;
+	if (buf[strspn(buf, " \t\r\n")] == '\0' || buf[0] == '#') {
+	    continue;
+	}
+	if (sscanf(buf, "%u %u %u %d %u",
+		   &size, &way, &line, &penalty, &writeback) < 4) {
+	    fprintf(stderr, "Invalid sweep line: %s", buf);
+	    fclose(fp);
+	    return false;
+	}
+	sweep.push_back(SweepPoint(size * 1024, way, line, penalty,
+				   writeback != 0));
+    }
+    fclose(fp);
+    return true;
+}
+
+bool
+PipeLine::Fork()
+{
+    /* one child a configuration, as many at a time as the cpus */
+    long  ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    std::vector<pid_t>  pids(sweep.size(), 0);
+    std::vector<int>  fds(sweep.size(), -1);
+    size_t  next = 0;
+    long  running = 0;
+
+    fflush(stdout);
+    /* no more children are started after a Ctrl-C */
+    while ((next < sweep.size() && !recieve_int) || running > 0) {
+	if (next < sweep.size() && running < ncpu && !recieve_int) {
+	    int  fd[2];
+	    if (pipe(fd) < 0) {
+		perror("pipe");
+		abort();
+	    }
+	    pid_t  pid = fork();
+	    if (pid < 0) {
+		perror("fork");
+		abort();
+	    }
+	    if (pid == 0) {
+		/* the child goes on from the shared state copy-on-write */
+		SweepPoint&  p = sweep[next];
+		close(fd[0]);
+		for (size_t i = 0; i < next; i++) {
+		    if (fds[i] >= 0) {
+			close(fds[i]);
+		    }
+		}
+		sweep_fd = fd[1];
+		dcache_enable = true;
+		dcache_size = p.size;
+		dcache_way = p.way;
+		dcache_line = p.line;
+		dcache_penalty = p.penalty;
+		dcache_writeback = p.writeback;
+		delete  dcache;
+		dcache = new Cache(dcache_size, dcache_way, dcache_line,
+				   dcache_penalty, dcache_writeback);
+		pipelog = false;
+		if (trace && !OpenTrace(trace_records)) {
+		    _exit(1);
+		}
+		int  null = open("/dev/null", O_WRONLY);
+		dup2(null, STDOUT_FILENO);
+		close(null);
+		return true;
+	    }
+	    close(fd[1]);
+	    pids[next] = pid;
+	    fds[next] = fd[0];
+	    next++;
+	    running++;
+	    continue;
+	}
+
+	pid_t  pid;
+	while ((pid = wait(NULL)) < 0) {
+	    /* a Ctrl-C also reaches the children, which stop and report */
+	    if (errno != EINTR) {
+		perror("wait");
+		abort();
+	    }
+	}
+	for (size_t i = 0; i < next; i++) {
+	    if (pids[i] != pid || fds[i] < 0) {
+		continue;
+	    }
+	    char  buf[256];
+	    ssize_t  n;
+	    while ((n = read(fds[i], buf, sizeof(buf))) > 0) {
+		sweep[i].result.append(buf, n);
+	    }
+	    close(fds[i]);
+	    fds[i] = -1;
+	    running--;
+	}
+    }
+    return false;
+}
+
+void
+PipeLine::PutSweepRow()
+{
+    FILE*  fp = fdopen(sweep_fd, "w");
+    unsigned long long  insts = *inst_count - inst_start;
+    fprintf(fp, " %12lld %12lld %8.4f", cycle, insts, (double)insts/cycle);
+    dcache->PutSummary(fp);
+    fclose(fp);
+}
+
+void
+PipeLine::PutSweep(double simtime)
+{
+    printf("\n####################\n");
+    printf("## sweep from inst count: %lld\n", inst_start);
+    printf("%6s %4s %5s %7s %2s %12s %12s %8s %10s %8s %10s %10s %10s\n",
+	   "size", "way", "line", "penalty", "wb", "cycle", "inst", "IPC",
+	   "access", "hit", "compulsory", "capacity", "conflict");
+    for (size_t i = 0; i < sweep.size(); i++) {
+	SweepPoint&  p = sweep[i];
+	printf("%6d %4d %5d %7d %2d%s\n", p.size/1024, p.way, p.line,
+	       p.penalty, p.writeback ? 1 : 0,
+	       !p.result.empty() ? p.result.c_str()
+	       : recieve_int ? " (not run)" : " (failed)");
+    }
+    printf("## simulation time: %8.3f\n", simtime);
+}
+
+void
+PipeLine::PutSample(double simtime)
+{
+    unsigned long long  insts = *inst_count - inst_start;
+    double  cpi = sample_cpi.Ratio();
+    double  ci = sample_cpi.Interval();
+
+    printf("\n####################\n");
+    printf("## sample count: %lld (%lld insts every %lld insts)\n",
+	   sample_cpi.n, sample_unit, sample_period);
+    printf("## inst count: %lld\n", insts);
+    printf("## detailed cycle count: %lld\n", cycle);
+    printf("## CPI: %f +- %f (95%% confidence)\n", cpi, ci);
+    printf("## IPC: %f (%f - %f)\n", cpi > 0 ? 1/cpi : 0,
+	   cpi + ci > 0 ? 1/(cpi + ci) : 0, cpi - ci > 0 ? 1/(cpi - ci) : 0);
+    printf("## estimated cycle count: %lld\n",
+	   (unsigned long long)(cpi * insts + 0.5));
+    printf("## simulation time: %8.3f\n", simtime);
+    if (dcache_enable) {
+	printf("*** miss ratio: %f +- %f (95%% confidence, %lld samples)\n",
+	       sample_miss.Ratio(), sample_miss.Interval(), sample_miss.n);
+    }
+}
+
+void
+PipeLine::PutSimpoint(double simtime)
+{
+    double  cpi = 0, miss = 0, weight = 0, mweight = 0;
+
+    printf("\n####################\n");
+    printf("## simpoints: %d intervals of %lld insts\n",
+	   (int)points.size(), point_interval);
+    printf("%10s %8s %12s %12s %8s%s\n", "interval", "weight", "inst",
+	   "cycle", "CPI", dcache_enable ? "     miss" : "");
+    for (size_t i = 0; i < points.size(); i++) {
+	PhasePoint&  p = points[i];
+	if (p.insts == 0) {
+	    printf("%10lld %8.4f (not reached)\n", p.interval, p.weight);
+	    continue;
+	}
+	double  c = (double)p.cycles / p.insts;
+	cpi += p.weight * c;
+	weight += p.weight;
+	printf("%10lld %8.4f %12lld %12lld %8.4f", p.interval, p.weight,
+	       p.insts, p.cycles, c);
+	if (dcache_enable && p.access > 0) {
+	    miss += p.weight * p.miss / p.access;
+	    mweight += p.weight;
+	    printf(" %8.4f", (double)p.miss / p.access);
+	}
+	printf("\n");
+    }
+    /* the weights of the intervals not reached are left out */
+    cpi = (weight > 0) ? cpi / weight : 0;
+    printf("## weighted CPI: %f\n", cpi);
+    printf("## IPC: %f\n", cpi > 0 ? 1/cpi : 0);
+    if (point_insts > 0) {
+	printf("## estimated cycle count: %lld (%lld insts)\n",
+	       (unsigned long long)(cpi * point_insts + 0.5), point_insts);
+    }
+    printf("## detailed cycle count: %lld\n", cycle);
+    printf("## simulation time: %8.3f\n", simtime);
+    if (dcache_enable) {
+	printf("*** weighted miss ratio: %f\n",
+	       (mweight > 0) ? miss / mweight : 0);
+    }
 }
 
 void
 PipeLine::ExecLoop()
 {
-    board->gettime();
-    while (mips->running() && !recieve_int) {
-	StepPipe();
+    Board::gettime();
+    /* pick the SimMips step for the debug/imix/cp0 mode once */
+    switch (trace ? (int)MODE_TRACE : mips->mode) {
+    case MODE_TRACE: RunLoop<MODE_TRACE>(); break;
+    case 0:  RunLoop<0>(); break;
+    case 1:  RunLoop<1>(); break;
+    case 2:  RunLoop<2>(); break;
+    case 3:  RunLoop<3>(); break;
+    case 4:  RunLoop<4>(); break;
+    case 5:  RunLoop<5>(); break;
+    case 6:  RunLoop<6>(); break;
+    default: RunLoop<7>(); break;
     }
 
+    if (logbin && !logbin->Close()) {
+	fprintf(stderr, "Can't write pipe-log file %s\n", PIPEBINNAME);
+    }
     if (recieve_int) {
 	printf("\n** Interrupted! **\n");
     }
-    double simtime = (double)board->gettime()/1000000.0;
+    double simtime = (double)Board::gettime()/1000000.0;
+    if (trace && trace->error) {
+	fprintf(stderr, "Trace %s is cut short\n", trace_file);
+    }
+    if (!sweep.empty()) {
+	PutSweep(simtime);
+	return;
+    }
+    if (!backends.empty()) {
+	PutMulti(simtime);
+	return;
+    }
+    if (sample_period > 0) {
+	PutSample(simtime);
+	return;
+    }
+    if (!points.empty()) {
+	PutSimpoint(simtime);
+	return;
+    }
     printf("\n####################\n");
     printf("## cycle count: %lld\n", cycle);
-    printf("## inst count: %lld\n", mips->ss->inst_count);
-    printf("## IPC: %f\n", (double)mips->ss->inst_count/cycle);
+    printf("## inst count: %lld\n", *inst_count - inst_start);
+    printf("## IPC: %f\n", (double)(*inst_count - inst_start)/cycle);
     printf("## simulation time: %8.3f\n", simtime);
     if (dcache_enable) {
 	dcache->PutStatistics();
     }
 }
 
+template <int MODE> void
+PipeLine::RunLoop()
+{
+    /* the warm-up is run once for every configuration of a sweep */
+    PipeOp  op;
+    for (unsigned long long i = 0;
+	 i < warmup && Running() && !recieve_int; i++) {
+	StepFunct<MODE>(&op);
+    }
+    /* a run resumed from a checkpoint or warmed up counts from there */
+    inst_start = *inst_count;
+    if (!sweep.empty() && !Fork()) {
+	return;
+    }
+    if (!backends.empty()) {
+	RunFront<MODE>();
+	return;
+    }
+
+    if (sample_period > 0) {
+	RunSample<MODE>();
+    } else if (!points.empty()) {
+	RunSimpoint<MODE>();
+    } else {
+	while (Running() && !recieve_int) {
+	    StepPipe<MODE>();
+	}
+    }
+    if (sweep_fd >= 0) {
+	PutSweepRow();
+	_exit(0);
+    }
+}
+
+template <int MODE> void
+PipeLine::RunFront()
+{
+    /* the insts run once are passed on to every back-end thread */
+    std::vector<pthread_t>  threads(backends.size());
+    for (size_t i = 0; i < backends.size(); i++) {
+	if (pthread_create(&threads[i], NULL, RunBack, backends[i]) != 0) {
+	    perror("pthread_create");
+	    abort();
+	}
+    }
+    PipeOp  op;
+    while (Running() && !recieve_int) {
+	StepFunct<MODE>(&op);
+	for (size_t i = 0; i < backends.size(); i++) {
+	    backends[i]->feed->Push(op);
+	}
+    }
+    for (size_t i = 0; i < backends.size(); i++) {
+	backends[i]->feed->Finish();
+    }
+    for (size_t i = 0; i < backends.size(); i++) {
+	pthread_join(threads[i], NULL);
+    }
+}
+
+void*
+PipeLine::RunBack(void* arg)
+{
+    ((PipeLine*)arg)->RunLoop<MODE_RING>();
+    return  NULL;
+}
+
 void
+PipeLine::PutMulti(double simtime)
+{
+    printf("\n####################\n");
+    printf("## %d configurations from inst count: %lld\n",
+	   (int)backends.size(), inst_start);
+    printf("%2s %6s %4s %5s %7s %2s %12s %12s %8s %10s %8s %10s %10s %10s\n",
+	   "fw", "size", "way", "line", "penalty", "wb", "cycle", "inst", "IPC",
+	   "access", "hit", "compulsory", "capacity", "conflict");
+    for (size_t i = 0; i < backends.size(); i++) {
+	PipeLine*  b = backends[i];
+	printf("%2d ", b->forwarding ? 1 : 0);
+	if (b->dcache_enable) {
+	    printf("%6d %4d %5d %7d %2d", b->dcache_size/1024, b->dcache_way,
+		   b->dcache_line, b->dcache_penalty, b->dcache_writeback ? 1 : 0);
+	} else {
+	    printf("%6s %4s %5s %7s %2s", "-", "-", "-", "-", "-");
+	}
+	printf(" %12lld %12lld %8.4f", b->cycle, b->trace_count,
+	       (double)b->trace_count/b->cycle);
+	if (b->dcache_enable) {
+	    b->dcache->PutSummary(stdout);
+	}
+	printf("\n");
+    }
+    printf("## simulation time: %8.3f\n", simtime);
+}
+
+template <int MODE> void
+PipeLine::RunSample()
+{
+    /* each period: fast-forward, detailed warming, then the measured unit */
+    unsigned long long&  inst = *inst_count;
+    while (Running() && !recieve_int) {
+	FastForward<MODE>(inst + sample_period - sample_detail - sample_unit);
+	RunDetail<MODE>(inst + sample_detail);
+
+	unsigned long long  cycle0 = cycle;
+	unsigned long long  inst0 = inst;
+	int  access0 = dcache_enable ? dcache->AccessCount() : 0;
+	int  hit0 = dcache_enable ? dcache->HitCount() : 0;
+	unsigned long long  mark = inst + sample_unit;
+	RunDetail<MODE>(mark);
+	if (inst < mark) {
+	    break; /* a unit cut short is not counted */
+	}
+	sample_cpi.Add(cycle - cycle0, inst - inst0);
+	if (dcache_enable && dcache->AccessCount() > access0) {
+	    int  access = dcache->AccessCount() - access0;
+	    sample_miss.Add(access - (dcache->HitCount() - hit0), access);
+	}
+    }
+}
+
+template <int MODE> void
+PipeLine::RunSimpoint()
+{
+    /* the intervals are visited in one pass, each warmed up in detail */
+    unsigned long long&  inst = *inst_count;
+    for (size_t i = 0; i < points.size(); i++) {
+	PhasePoint&  p = points[i];
+	unsigned long long  start = p.interval * point_interval;
+	unsigned long long  warm = (start > sample_detail)
+	    ? start - sample_detail : 0;
+	FastForward<MODE>(warm);
+	RunDetail<MODE>(start);
+	if (!Running() || recieve_int) {
+	    break;
+	}
+
+	unsigned long long  cycle0 = cycle;
+	unsigned long long  inst0 = inst;
+	int  access0 = dcache_enable ? dcache->AccessCount() : 0;
+	int  hit0 = dcache_enable ? dcache->HitCount() : 0;
+	RunDetail<MODE>(start + point_interval);
+	p.insts = inst - inst0;
+	p.cycles = cycle - cycle0;
+	if (dcache_enable) {
+	    p.access = dcache->AccessCount() - access0;
+	    p.miss = p.access - (dcache->HitCount() - hit0);
+	}
+    }
+}
+
+template <int MODE> void
+PipeLine::FastForward(unsigned long long mark)
+{
+    unsigned long long&  inst = *inst_count;
+    PipeOp  op;
+    while (inst < mark && Running() && !recieve_int) {
+	StepFunct<MODE>(&op);
+	if (sample_fwcache && dcache_enable && (op.attr & LOADSTORE)) {
+	    dcache->Access(op.paddr, (op.attr & LOAD_ANY)
+			   ? Cache::CACHE_READ : Cache::CACHE_WRITE);
+	}
+    }
+    /* the ops in flight were executed already, the pipe starts empty */
+    ResetPipe();
+}
+
+template <int MODE> void
+PipeLine::RunDetail(unsigned long long mark)
+{
+    while (*inst_count < mark && Running() && !recieve_int) {
+	StepPipe<MODE>();
+    }
+}
+
+void
+PipeLine::ResetPipe()
+{
+    for (int i = 0; i < PIPE_DEPTH; i++) {
+	stage_state[i] = STAGE_IDLE;
+	stage_wait_cycle[i] = 0;
+	latches[i].contain = false;
+	latches[i].uop = &idle_op;
+    }
+    reg_state = ScoreBoard();
+}
+
+template <int MODE> void
 PipeLine::StepPipe()
 {
+    /* done before the cycle, so a run stopped at an inst count
+       does not take in the cycles after it */
+    if (stage_state[SMEM] == STAGE_BUSY && stage_wait_cycle[SMEM] > 1) {
+	SkipCycles();
+    }
     cycle++;
     WriteBack();
     Mem();
     Exec();
     Decode();
-    Fetch();
+    Fetch<MODE>();
 
     if (pipelog) {
 	PutPipeLog();
     }
 
-    latches[SWB].inst.op = 0;
+    latches[SWB].uop = &idle_op;
     for (int i = PIPE_DEPTH-2; i >= 0; i--) {
 	if (stage_state[i] == STAGE_STALL && !latches[i+1].contain) {
 	    ShiftStage(i);
@@ -204,70 +910,214 @@ PipeLine::StepPipe()
     }
 }
 
+/* While Mem waits for the dcache, the cycles in which no other stage
+   can move are passed over at once.  After the last shift a stalled
+   stage always has a full latch ahead of it, so those cycles are the
+   ones with WriteBack empty, Exec done, Fetch holding its op, and
+   Decode done or waiting for a register only WriteBack frees. */
+void
+PipeLine::SkipCycles()
+{
+    if (latches[SWB].contain
+	|| (stage_state[SEXEC] == STAGE_IDLE && latches[SEXEC].contain)
+	|| stage_state[SFETCH] != STAGE_STALL
+	|| (stage_state[SDECODE] == STAGE_IDLE
+	    && SourceReady(latches[SDECODE].uop))) {
+	return;
+    }
+    /* the last cycle, in which Mem gets done, is run as usual */
+    int  skip = stage_wait_cycle[SMEM]-1;
+    stage_wait_cycle[SMEM] = 1;
+    if (pipelog) {
+	for (int i = 0; i < skip; i++) {
+	    cycle++;
+	    PutPipeLog();
+	}
+    } else {
+	cycle += skip;
+    }
+}
+
 void
 PipeLine::PutPipeLog()
 {
+    if (log_pc_span > 0 && ring_head != log_head
+	&& latches[SFETCH].uop->pc == log_pc) {
+	log_until = cycle + log_pc_span - 1;
+    }
+    log_head = ring_head;
+    if (cycle < log_from || cycle > log_to
+	|| (log_pc_span > 0 && cycle > log_until)) {
+	return;
+    }
+    if (logbin) {
+	PipeLogRec  rec = PipeLogRec();
+	rec.cycle = cycle;
+	rec.fetched = ring_head;
+	for (int i = 0; i < PIPE_DEPTH; i++) {
+	    PipeOp*  uop = latches[i].uop;
+	    /* the last op fetched into the slot, as all in flight differ */
+	    if (uop != &idle_op) {
+		rec.back[i] = (ring_head-1 - (uop - ring)) & (RING_SIZE-1);
+	    }
+	    rec.pc[i] = uop->pc;
+	    rec.op[i] = uop->op;
+	    rec.state[i] = stage_state[i]
+		| (uop == &idle_op ? PipeLogRec::EMPTY : 0)
+		| (latches[i].contain ? PipeLogRec::FULL : 0);
+	}
+	logbin->Put(rec);
+	return;
+    }
+
+    MipsInst  name[PIPE_DEPTH];
+    for (int i = 0; i < PIPE_DEPTH; i++) {
+	name[i].op = latches[i].uop->op;
+    }
     fprintf(logfd, "%6lld: |%8x|%7s|%7s|%7s|%7s|%7s|\n",
 	    cycle,
-	    latches[SFETCH].inst.pc,
-	    latches[SFETCH].inst.getinstname(),
-	    latches[SDECODE].inst.getinstname(),
-	    latches[SEXEC].inst.getinstname(),
-	    latches[SMEM].inst.getinstname(),
-	    latches[SWB].inst.getinstname());
+	    latches[SFETCH].uop->pc,
+	    name[SFETCH].getinstname(),
+	    name[SDECODE].getinstname(),
+	    name[SEXEC].getinstname(),
+	    name[SMEM].getinstname(),
+	    name[SWB].getinstname());
 }
 
 inline void
 PipeLine::ShiftStage(int stageid)
 {
-    memcpy(&latches[stageid+1].inst, &latches[stageid].inst, sizeof(MipsInst));
-    latches[stageid+1].paddr = latches[stageid].paddr;
+    latches[stageid+1].uop = latches[stageid].uop;
     latches[stageid+1].contain = true;
     latches[stageid  ].contain = false;
-    latches[stageid  ].inst.op = 0;
+    latches[stageid  ].uop = &idle_op;
     stage_state[stageid] = STAGE_IDLE;
 }
 
+/* the masks of the scoreboard an op reads and writes, found once */
+inline void
+PipeLine::SetRegMasks(PipeOp* uop)
+{
+    uint064_t  reads = 0;
+    uint064_t  writes = 0;
+    uint  attr = uop->attr;
+    if (attr & READ_RS) {
+	reads |= 1ULL << uop->rs;
+    }
+    if (attr & READ_RT) {
+	reads |= 1ULL << uop->rt;
+    }
+    if (attr & READ_HI) {
+	reads |= 1ULL << PIPE_REG_HI;
+    }
+    if (attr & READ_LO) {
+	reads |= 1ULL << PIPE_REG_LO;
+    }
+    if (attr & WRITE_RS) {
+	writes |= 1ULL << uop->rs;
+    }
+    if (attr & WRITE_RT) {
+	writes |= 1ULL << uop->rt;
+    }
+    if (attr & (WRITE_RD | WRITE_RD_COND)) {
+	writes |= 1ULL << uop->rd;
+    }
+    if (attr & WRITE_RRA) {
+	writes |= 1ULL << REG_RA;
+    }
+    if (attr & WRITE_HI) {
+	writes |= 1ULL << PIPE_REG_HI;
+    }
+    if (attr & WRITE_LO) {
+	writes |= 1ULL << PIPE_REG_LO;
+    }
+    /* $0 is never locked */
+    uop->reads = reads & ~1ULL;
+    uop->writes = writes & ~1ULL;
+}
+
 inline bool
-PipeLine::RegAvailable(int reg, bool branch)
+PipeLine::SourceReady(const PipeOp* inst)
 {
-    if (reg == 0) {
+    uint064_t  locked = inst->reads & reg_state.locked;
+    if (locked == 0) {
 	return true;
     }
-    if (reg_state[reg].locked > 0) {
-	if (!forwarding) {
-	    return false;
-	}
-	if (branch) {
-	    if (reg_state[reg].ex2_fw) {
-		return true;
-	    }
-	} else {
-	    if (reg_state[reg].ex_fw
-		|| (!reg_state[reg].load0_fw && reg_state[reg].ex2_fw)
-		|| reg_state[reg].load_fw) {
-		return true;
-	    }
-	}
+    if (!forwarding) {
 	return false;
     }
-    return true;
+    /* a branch gets only what has passed Exec (v0.1.4), and a load
+       in Exec cancels the older op's Exec forwarding (v0.1.3) */
+    uint064_t  forwarded;
+    if (inst->attr & BRANCH) {
+	forwarded = reg_state.ex2_fw;
+    } else {
+	forwarded = reg_state.ex_fw
+	    | (reg_state.ex2_fw & ~reg_state.load0_fw)
+	    | reg_state.load_fw;
+    }
+    return  (locked & ~forwarded) == 0;
 }
 
-void
+/* one inst run functionally, or read from the trace */
+template <int MODE> inline void
+PipeLine::StepFunct(PipeOp* uop)
+{
+    unsigned long long  count = mips->ss->inst_count;
+    board->chip->step_funct<MODE>();
+    MipsInst*  inst = mips->inst;
+    uop->counted = (mips->ss->inst_count != count);
+    uop->pc = inst->pc;
+    uop->op = inst->op;
+    uop->attr = inst->attr;
+    uop->rs = inst->rs;
+    uop->rt = inst->rt;
+    uop->rd = inst->rd;
+    if (inst->attr & LOADSTORE) {
+	uop->paddr = mips->get_paddr();
+    }
+}
+
+template <> inline void
+PipeLine::StepFunct<PipeLine::MODE_TRACE>(PipeOp* uop)
+{
+    uop->pc = trace_next.pc;
+    uop->op = trace_next.op;
+    uop->attr = trace_next.attr;
+    uop->rs = trace_next.rs;
+    uop->rt = trace_next.rt;
+    uop->rd = trace_next.rd;
+    uop->paddr = trace_next.paddr;
+    uop->counted = trace_next.counted;
+    if (trace_next.counted) {
+	trace_count++;
+    }
+    trace_more = trace->get(&trace_next);
+    trace_records++;
+}
+
+template <> inline void
+PipeLine::StepFunct<PipeLine::MODE_RING>(PipeOp* uop)
+{
+    feed->Pop(uop);
+    if (uop->counted) {
+	trace_count++;
+    }
+}
+
+template <int MODE> void
 PipeLine::Fetch()
 {
     switch (stage_state[SFETCH]) {
     case  STAGE_IDLE: {
+	/* at most PIPE_DEPTH ops are in flight, so the slot is free */
+	PipeOp*  uop = &ring[ring_head++ & (RING_SIZE-1)];
+	StepFunct<MODE>(uop);
+	SetRegMasks(uop);
 #ifdef  DEBUG_PIPELINE
-	fprintf(stderr, "Fetch Address: %x\n", mips->as->pc);
+	fprintf(stderr, "Fetch Address: %x\n", uop->pc);
 #endif
-
-	board->chip->step_funct();
-	memcpy(&latches[SFETCH].inst, mips->inst, sizeof(MipsInst));
-	if (mips->inst->attr & LOADSTORE) {
-	    latches[SFETCH].paddr = mips->get_paddr();
-	}
+	latches[SFETCH].uop = uop;
 	stage_state[SFETCH] = STAGE_STALL;
     } break;
     case  STAGE_STALL:
@@ -285,49 +1135,19 @@ PipeLine::Decode()
     switch (stage_state[SDECODE]) {
     case  STAGE_IDLE: {
 	if (latches[SDECODE].contain) {
-	    MipsInst*  inst = &latches[SDECODE].inst;
+	    PipeOp*  inst = latches[SDECODE].uop;
 #ifdef  DEBUG_PIPELINE
-	    fprintf(stderr, "Decode: %s\n", inst->getinstname());
+	    MipsInst  name;
+	    name.op = inst->op;
+	    fprintf(stderr, "Decode: %s\n", name.getinstname());
 #endif
-	    bool  ready_rs = true;
-	    bool  ready_rt = true;
-	    bool  ready_hi = true;
-	    bool  ready_lo = true;
-	    bool  branch   = (inst->attr & BRANCH);
-	    if (inst->attr & READ_RS) {
-		ready_rs = RegAvailable(inst->rs, branch);
-	    }
-	    if (inst->attr & READ_RT) {
-		ready_rt = RegAvailable(inst->rt, branch);
-	    }
-	    if (inst->attr & READ_HI) {
-		ready_hi = RegAvailable(PIPE_REG_HI, branch);
-	    }
-	    if (inst->attr & READ_LO) {
-		ready_lo = RegAvailable(PIPE_REG_LO, branch);
-	    }
-	    if (!ready_rs || !ready_rt || !ready_hi || !ready_lo) {
+	    if (!SourceReady(inst)) {
 		break; /* Retry at next cycle. */
 	    }
-	    if (inst->attr & WRITE_RS) {
-		reg_state[inst->rs].locked++;
-	    }
-	    if (inst->attr & WRITE_RT) {
-		reg_state[inst->rt].locked++;
-	    }
-	    if (inst->attr & (WRITE_RD | WRITE_RD_COND)) {
-		reg_state[inst->rd].locked++;
-	    }
-	    if (inst->attr & WRITE_RRA) {
-		reg_state[REG_RA].locked++;
-	    }
-	    if (inst->attr & WRITE_HI) {
-		reg_state[PIPE_REG_HI].locked++;
-	    }
-	    if (inst->attr & WRITE_LO) {
-		reg_state[PIPE_REG_LO].locked++;
+	    for (uint064_t w = inst->writes; w != 0; w &= w-1) {
+		reg_state.writers[__builtin_ctzll(w)]++;
 	    }
-	    reg_state[0].locked = 0;
+	    reg_state.locked |= inst->writes;
 	    stage_state[SDECODE] = STAGE_STALL;
 	}
     } break;
@@ -347,33 +1167,15 @@ PipeLine::Exec()
     switch (stage_state[SEXEC]) {
     case  STAGE_IDLE: {
 	if (latches[SEXEC].contain) {
-	    MipsInst*  inst = &latches[SEXEC].inst;
+	    PipeOp*  inst = latches[SEXEC].uop;
 	    if (forwarding) {
 		if (!(inst->attr & LOADSTORE)) {
-		    if (inst->attr & WRITE_RS) {
-			reg_state[inst->rs].ex_fw = true;
-		    }
-		    if (inst->attr & WRITE_RT) {
-			reg_state[inst->rt].ex_fw = true;
-		    }
-		    if (inst->attr & (WRITE_RD | WRITE_RD_COND)) {
-			reg_state[inst->rd].ex_fw = true;
-		    }
-		    if (inst->attr & WRITE_HI) {
-			reg_state[PIPE_REG_HI].ex_fw = true;
-		    }
-		    if (inst->attr & WRITE_LO) {
-			reg_state[PIPE_REG_LO].ex_fw = true;
-		    }
-		    if (inst->attr & WRITE_RRA) {
-			reg_state[REG_RA].ex_fw = true;
-		    }
+		    reg_state.ex_fw |= inst->writes;
 		} else if ((inst->attr & LOAD_ANY)
 			   && inst->rt != 0) {
 		    // cancel forwarded data from a previous insn.
-		    reg_state[inst->rt].load0_fw = true;
+		    reg_state.load0_fw |= 1ULL << inst->rt;
 		}
-		reg_state[0].ex_fw = 0;
 	    }
 	    stage_state[SEXEC] = STAGE_STALL;
 	}
@@ -394,49 +1196,22 @@ PipeLine::Mem()
     case  STAGE_IDLE: {
 	if (latches[SMEM].contain) {
 	    int  wait = 0;
-	    MipsInst*  inst = &latches[SMEM].inst;
+	    PipeOp*  inst = latches[SMEM].uop;
 	    if (inst->attr & LOADSTORE) {
 		if (dcache_enable) {
 		    int rwtype = (inst->attr&LOAD_ANY)
 			? Cache::CACHE_READ : Cache::CACHE_WRITE;
-		    wait = dcache->Access(latches[SMEM].paddr, rwtype)-1;
+		    wait = dcache->Access(inst->paddr, rwtype)-1;
 		} else {
 		    wait = 0;
 		}
-		if (inst->attr & WRITE_RT) {
-		    if (forwarding && inst->rt != 0) {
-			reg_state[inst->rt].load0_fw = false;
-			reg_state[inst->rt].load_fw  = true;
-		    }
-		    reg_state[0].load_fw = false;
-		}
-	    } else { /* exec instructions */
-		if (forwarding) {
-		    if (inst->attr & WRITE_RS) {
-			reg_state[inst->rs].ex_fw  = false;
-			reg_state[inst->rs].ex2_fw = true;
-		    }
-		    if (inst->attr & WRITE_RT) {
-			reg_state[inst->rt].ex_fw  = false;
-			reg_state[inst->rt].ex2_fw = true;
-		    }
-		    if (inst->attr & (WRITE_RD | WRITE_RD_COND)) {
-			reg_state[inst->rd].ex_fw  = false;
-			reg_state[inst->rd].ex2_fw = true;
-		    }
-		    if (inst->attr & WRITE_HI) {
-			reg_state[PIPE_REG_HI].ex_fw  = false;
-			reg_state[PIPE_REG_HI].ex2_fw = true;
-		    }
-		    if (inst->attr & WRITE_LO) {
-			reg_state[PIPE_REG_LO].ex_fw  = false;
-			reg_state[PIPE_REG_LO].ex2_fw = true;
-		    }
-		    if (inst->attr & WRITE_RRA) {
-			reg_state[REG_RA].ex_fw =  false;
-			reg_state[REG_RA].ex2_fw = true;
-		    }
+		if ((inst->attr & WRITE_RT) && forwarding && inst->rt != 0) {
+		    reg_state.load0_fw &= ~(1ULL << inst->rt);
+		    reg_state.load_fw  |= 1ULL << inst->rt;
 		}
+	    } else if (forwarding) { /* exec instructions */
+		reg_state.ex_fw  &= ~inst->writes;
+		reg_state.ex2_fw |= inst->writes;
 	    }
 	    stage_wait_cycle[SMEM] = wait;
 	    stage_state[SMEM] = (wait > 0) ? STAGE_BUSY : STAGE_STALL;
@@ -457,48 +1232,27 @@ PipeLine::Mem()
     }
 }
 
-inline void
-PipeLine::WriteBackReg(int reg)
-{
-#ifdef  DEBUG_PIPELINE
-    fprintf(stderr, "WriteBack: %d\n", reg);
-#endif
-    if (reg == 0) {
-	return;
-    }
-    reg_state[reg].locked--;
-    assert(reg_state[reg].locked >= 0);
-    if (forwarding) {
-	reg_state[reg].ex2_fw  = false;
-	reg_state[reg].load_fw = false;
-    }
-}
-
 void
 PipeLine::WriteBack()
 {
     assert(stage_state[SWB] == STAGE_IDLE);
     if (latches[SWB].contain) {
-	MipsInst*  inst = &latches[SWB].inst;
+	PipeOp*  inst = latches[SWB].uop;
 	latches[SWB].contain = false;
 
-	if (inst->attr & WRITE_RS) {
-	    WriteBackReg(inst->rs);
-	}
-	if (inst->attr & WRITE_RT) {
-	    WriteBackReg(inst->rt);
-	}
-	if (inst->attr & (WRITE_RD | WRITE_RD_COND)) {
-	    WriteBackReg(inst->rd);
-	}
-	if (inst->attr & WRITE_HI) {
-	    WriteBackReg(PIPE_REG_HI);
-	}
-	if (inst->attr & WRITE_LO) {
-	    WriteBackReg(PIPE_REG_LO);
+#ifdef  DEBUG_PIPELINE
+	fprintf(stderr, "WriteBack: %llx\n", inst->writes);
+#endif
+	for (uint064_t w = inst->writes; w != 0; w &= w-1) {
+	    int  reg = __builtin_ctzll(w);
+	    assert(reg_state.writers[reg] > 0);
+	    if (--reg_state.writers[reg] == 0) {
+		reg_state.locked &= ~(1ULL << reg);
+	    }
 	}
-	if (inst->attr & WRITE_RRA) {
-	    WriteBackReg(REG_RA);
+	if (forwarding) {
+	    reg_state.ex2_fw  &= ~inst->writes;
+	    reg_state.load_fw &= ~inst->writes;
 	}
     }
 }
@@ -6,29 +6,152 @@
 #ifndef  PIPE_H
 #define  PIPE_H
 
+#include  <atomic>
+#include  <cmath>
 #include  <cstdio>
+#include  <cstring>
+#include  <sched.h>
+#include  <string>
+#include  <vector>
 #ifndef  L_NAME
 #include  "define.h"
 #endif
 #include  "cache.h"
+#include  "pipelog.h"
 
 #define  PIPELOGNAME  "pipe.log"
 
+/* what the stages need of an instruction, instead of its MipsInst */
+struct PipeOp {
+    PipeOp() { pc = 0; op = 0; attr = 0; rs = rt = rd = 0; counted = true;
+	paddr = 0; reads = writes = 0; }
+    uint032_t  pc;
+    uint032_t  op;  /* the name is looked up only for the log */
+    uint  attr;
+    uint008_t  rs;
+    uint008_t  rt;
+    uint008_t  rd;
+    bool  counted;  /* false if the inst count did not go up */
+    uint064_t  paddr;
+    uint064_t  reads;   /* the registers read, a bit each, but $0 */
+    uint064_t  writes;  /* the registers written */
+};
+
+/* the ops of one functional run, from the front-end to one back-end;
+   a single producer and a single consumer, so no lock is needed */
+class OpRing {
+public:
+    OpRing() : head(0), done(false), tail_seen(0), tail(0), head_seen(0) {}
+
+    void Push(const PipeOp& op) {
+	unsigned long  h = head.load(std::memory_order_relaxed);
+	while (h - tail_seen >= RING_OPS) {
+	    tail_seen = tail.load(std::memory_order_acquire);
+	    if (h - tail_seen >= RING_OPS) {
+		sched_yield();
+	    }
+	}
+	ops[h & (RING_OPS-1)] = op;
+	head.store(h+1, std::memory_order_release);
+    }
+    void Finish() { done.store(true, std::memory_order_release); }
+
+    /* waits for the next op, false if there is none any more */
+    bool Wait() {
+	unsigned long  t = tail.load(std::memory_order_relaxed);
+	while (t == head_seen) {
+	    bool  last = done.load(std::memory_order_acquire);
+	    head_seen = head.load(std::memory_order_acquire);
+	    if (t != head_seen) {
+		break;
+	    }
+	    if (last) {
+		return false;
+	    }
+	    sched_yield();
+	}
+	return true;
+    }
+    void Pop(PipeOp* op) {
+	unsigned long  t = tail.load(std::memory_order_relaxed);
+	*op = ops[t & (RING_OPS-1)];
+	tail.store(t+1, std::memory_order_release);
+    }
+
+private:
+    enum { RING_OPS = 0x4000 };
+    /* the producer's and the consumer's sides on their own lines */
+    alignas(64) std::atomic<unsigned long>  head;
+    std::atomic<bool>  done;
+    unsigned long  tail_seen;
+    alignas(64) std::atomic<unsigned long>  tail;
+    unsigned long  head_seen;
+    alignas(64) PipeOp  ops[RING_OPS];
+};
+
 struct Latch {
-    Latch() { contain = false; }
+    Latch() { contain = false; uop = NULL; }
     bool  contain;
-    MipsInst  inst;
-    uint064_t  paddr;
+    PipeOp*  uop; /* into the ring, shifted by the pointer */
 };
 
-struct RegBoard {
-    RegBoard() { locked = 0; ex_fw = false; ex2_fw = false;
-	load0_fw = false; load_fw = false; }
-    int   locked;
-    bool  ex_fw;
-    bool  ex2_fw;
-    bool  load0_fw;
-    bool  load_fw;
+struct SweepPoint {
+    SweepPoint(uint032_t size, uint032_t way, uint032_t line, int penalty,
+	       bool writeback)
+	: size(size), way(way), line(line), penalty(penalty),
+	  writeback(writeback) {}
+    uint032_t  size;
+    uint032_t  way;
+    uint032_t  line;
+    int  penalty;
+    bool  writeback;
+    std::string  result; /* the row sent back by its child */
+};
+
+/* a representative interval picked by SimMips/simpoint */
+struct PhasePoint {
+    PhasePoint(unsigned long long interval, double weight)
+	: interval(interval), weight(weight), insts(0), cycles(0),
+	  access(0), miss(0) {}
+    bool operator<(const PhasePoint& p) const { return interval < p.interval; }
+    unsigned long long  interval;
+    double  weight;
+    unsigned long long  insts;  /* measured, 0 if never reached */
+    unsigned long long  cycles;
+    int  access;
+    int  miss;
+};
+
+/* a ratio x/y estimated from samples, with its 95% confidence interval */
+struct SampleStat {
+    SampleStat() { n = 0; x = y = xx = xy = yy = 0; }
+    void Add(double sx, double sy) {
+	n++; x += sx; y += sy; xx += sx*sx; xy += sx*sy; yy += sy*sy;
+    }
+    double Ratio() const { return y > 0 ? x/y : 0; }
+    double Interval() const {
+	if (n < 2 || y <= 0) {
+	    return 0;
+	}
+	double  r = x/y;
+	double  var = (xx - 2*r*xy + r*r*yy) / (n-1);
+	return 1.96 * sqrt(var > 0 ? var : 0) / sqrt((double)n) / (y/n);
+    }
+    unsigned long long  n;
+    double  x, y, xx, xy, yy;
+};
+
+/* the state of the GPRs, Hi and Lo, a bit for each in every mask */
+struct ScoreBoard {
+    enum { REGS = 34 };
+    ScoreBoard() { locked = 0; ex_fw = 0; ex2_fw = 0; load0_fw = 0;
+	load_fw = 0; memset(writers, 0, sizeof(writers)); }
+    uint064_t  locked;   /* has a write in flight */
+    uint064_t  ex_fw;
+    uint064_t  ex2_fw;
+    uint064_t  load0_fw;
+    uint064_t  load_fw;
+    uint008_t  writers[REGS]; /* the writes in flight, locked if not 0 */
 };
 
 class PipeLine {
@@ -39,31 +162,57 @@ public:
     int PipeInit(int argc, char** argv);
 
     void ExecLoop();
-    void StepPipe();
+    template <int MODE> void StepPipe();
 
 private:
     char** CheckOpt(int argc, char** argv, int* bargc);
     void   help();
+    bool   ReadSweep(const char* filename);
+    bool   Fork();
+    void   PutSweepRow();
+    void   PutSweep(double simtime);
+    void   PutSample(double simtime);
+    bool   ReadSimpoint(const char* filename);
+    void   PutSimpoint(double simtime);
 
-    void Fetch();
+    template <int MODE> void RunLoop();
+    template <int MODE> void RunFront();
+    static void* RunBack(void* arg);
+    void   PutMulti(double simtime);
+    template <int MODE> void RunSample();
+    template <int MODE> void RunSimpoint();
+    template <int MODE> void StepFunct(PipeOp* uop);
+    template <int MODE> void FastForward(unsigned long long mark);
+    template <int MODE> void RunDetail(unsigned long long mark);
+    void ResetPipe();
+    bool OpenTrace(unsigned long long skip);
+    bool Running() {
+	return feed ? feed->Wait() : trace ? trace_more : mips->running();
+    }
+    template <int MODE> void Fetch();
     void Decode();
     void Exec();
     void Mem();
     void WriteBack();
 
+    void SkipCycles();
     void PutPipeLog();
     void PutConfig();
+    void PutPipeConfig();
 
     inline void ShiftStage(int stageid);
-    inline bool RegAvailable(int reg, bool branch);
-    inline void WriteBackReg(int reg);
+    inline void SetRegMasks(PipeOp* uop);
+    inline bool SourceReady(const PipeOp* inst);
 
     enum { PIPE_DEPTH = 5 };
+    enum { MODE_TRACE = MODE_NUM,     /* read from a trace, not run */
+	   MODE_RING = MODE_NUM+1 };  /* fed by another PipeLine */
+    enum { RING_SIZE = 8 }; /* a power of 2 above PIPE_DEPTH */
     enum { GEN_REG = 32 };
     enum { PIPE_REG_HI = 32, PIPE_REG_LO = 33 };
-    enum { STAGE_IDLE,
-	   STAGE_BUSY, /* waiting for its execution */
-	   STAGE_STALL}; /* waiting for output-latch's ready state */
+    enum { STAGE_IDLE = PipeLogRec::IDLE,
+	   STAGE_BUSY = PipeLogRec::BUSY, /* waiting for its execution */
+	   STAGE_STALL = PipeLogRec::STALL}; /* waiting for output-latch's ready state */
     enum { SFETCH = 0,
 	   SDECODE,
 	   SEXEC,
@@ -75,20 +224,42 @@ private:
 	   DEFAULT_DCACHE_LINE    = 16,
 	   DEFAULT_DCACHE_PENALTY = 10,
 	   DEFAULT_DCACHE_WRITEBACK = 1 };
+    enum { DEFAULT_SAMPLE_UNIT   = 1000,
+	   DEFAULT_SAMPLE_DETAIL = 2000 };
 
     Board*  board;
     Mips*   mips;
+    unsigned long long*  inst_count; /* of mips, or of the trace */
     int    stage_state[PIPE_DEPTH];
     int    stage_wait_cycle[PIPE_DEPTH];
     Latch  latches[PIPE_DEPTH];
-    RegBoard  reg_state[GEN_REG+2]; /* GPR(32)+Hi+Lo */
+    PipeOp  ring[RING_SIZE];
+    uint  ring_head;
+    PipeOp  idle_op; /* shown in the log for an empty latch */
+    ScoreBoard  reg_state; /* GPR(32)+Hi+Lo */
 
     Cache*  dcache;
 
     unsigned long long  cycle;
+    unsigned long long  warmup;
+    unsigned long long  inst_start;
     bool  forwarding;
     bool  pipelog;
 
+    std::vector<SweepPoint>  sweep;
+    int  sweep_fd; /* to the parent, in a child of a sweep */
+
+    unsigned long long  sample_period; /* insts, 0 unless sampling */
+    unsigned long long  sample_unit;   /* insts measured a period */
+    unsigned long long  sample_detail; /* insts run in detail before it */
+    bool  sample_fwcache; /* the dcache is warmed while fast-forwarding */
+    SampleStat  sample_cpi;
+    SampleStat  sample_miss;
+
+    std::vector<PhasePoint>  points;  /* sorted by interval */
+    unsigned long long  point_interval; /* insts in an interval */
+    unsigned long long  point_insts;    /* of the whole profiled run */
+
     bool dcache_enable;
     uint032_t  dcache_size;
     uint032_t  dcache_way;
@@ -97,6 +268,24 @@ private:
     bool dcache_writeback;
 
     FILE*  logfd;
+    LogWriter*  logbin; /* instead of logfd, with -lb */
+    bool  logbin_compress;
+    unsigned long long  log_from;  /* the window of cycles logged */
+    unsigned long long  log_to;
+    uint032_t  log_pc;  /* and the cycles after it is fetched */
+    unsigned long long  log_pc_span; /* 0 unless -log-pc */
+    unsigned long long  log_until;
+    uint  log_head;     /* ring_head at the last cycle logged */
+
+    const char*  trace_file;
+    InstTrace*  trace; /* instead of board, when replaying a trace */
+    traceinst_t  trace_next; /* read ahead, to know the end */
+    bool  trace_more;
+    unsigned long long  trace_count;   /* insts fetched from it or ring */
+    unsigned long long  trace_records; /* records read from it */
+
+    std::vector<PipeLine*>  backends; /* the configurations after -next */
+    OpRing*  feed; /* from the front-end, in a back-end */
 };
 
 #endif	// PIPE_H
@@ -0,0 +1,335 @@
+/* -*-c++-*-
+ * SimPipe: a MIPS Pipeline Simulator using SimMips
+ *   Keiji Kimura
+ */
+
+#include  <cstdlib>
+#include  <cstring>
+#include  <zlib.h>
+#include  "pipelog.h"
+
+static inline uint008_t*
+PutVar(uint008_t* p, uint064_t v)
+{
+    while (v >= 0x80) {
+	*p++ = (uint008_t)(v | 0x80);
+	v >>= 7;
+    }
+    *p++ = (uint008_t)v;
+    return  p;
+}
+
+static inline bool
+GetVar(const uint008_t*& p, const uint008_t* end, uint064_t* v)
+{
+    *v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+	uint008_t  b = *p++;
+	*v |= (uint064_t)(b & 0x7f) << shift;
+	if (!(b & 0x80)) {
+	    return  true;
+	}
+    }
+    return  false;
+}
+
+LogCodec::LogCodec()
+{
+    last = PipeLogRec();
+    last_pc = 0;
+    for (int i = 0; i < PipeLogRec::DEPTH; i++) {
+	last.state[i] = PipeLogRec::EMPTY;
+    }
+}
+
+size_t
+LogCodec::Encode(const PipeLogRec& rec, uint008_t* buf)
+{
+    uint008_t*  p = buf + 1;
+    int  flag = 0;
+    if (rec.cycle != last.cycle+1) {
+	flag |= CYCLE_DELTA;
+	p = PutVar(p, rec.cycle - last.cycle);
+    }
+    uint032_t  fetched = rec.fetched - last.fetched;
+    if (fetched == 1) {
+	flag |= FETCH_ONE;
+    } else if (fetched != 0) {
+	flag |= FETCH_DELTA;
+	p = PutVar(p, fetched);
+    }
+    buf[0] = (uint008_t)flag;
+
+    int  how[PipeLogRec::DEPTH];
+    uint032_t  codes = 0;
+    for (int i = 0; i < PipeLogRec::DEPTH; i++) {
+	bool  empty = (rec.state[i] & PipeLogRec::EMPTY);
+	how[i] = OP_FULL;
+	if (empty && rec.pc[i] == 0 && rec.op[i] == 0) {
+	    how[i] = OP_NONE;
+	} else if (!empty) {
+	    for (int from = i; from >= i-1 && from >= 0; from--) {
+		if (!(last.state[from] & PipeLogRec::EMPTY)
+		    && last.Seq(from) == rec.Seq(i)
+		    && last.pc[from] == rec.pc[i]
+		    && last.op[from] == rec.op[i]) {
+		    how[i] = (from == i) ? OP_SAME : OP_SHIFTED;
+		    break;
+		}
+	    }
+	}
+	codes |= how[i] << (2*i);
+    }
+    *p++ = (uint008_t)codes;
+    *p++ = (uint008_t)(codes >> 8);
+    for (int i = 0; i < PipeLogRec::DEPTH; i += 2) {
+	uint008_t  packed = 0;
+	for (int j = i; j < i+2 && j < PipeLogRec::DEPTH; j++) {
+	    uint008_t  s = (rec.state[j] & 0x03)
+		| ((rec.state[j] & PipeLogRec::EMPTY) ? 0x04 : 0)
+		| ((rec.state[j] & PipeLogRec::FULL) ? 0x08 : 0);
+	    packed |= s << (4*(j-i));
+	}
+	*p++ = packed;
+    }
+    /* the pc is given against the last one given, as it goes on by 4 */
+    for (int i = 0; i < PipeLogRec::DEPTH; i++) {
+	if (how[i] != OP_FULL) {
+	    continue;
+	}
+	int032_t  d = (int032_t)(rec.pc[i] - (last_pc + 4));
+	p = PutVar(p, (uint032_t)((d << 1) ^ (d >> 31)));
+	last_pc = rec.pc[i];
+	for (int b = 0; b < 32; b += 8) {
+	    *p++ = (uint008_t)(rec.op[i] >> b);
+	}
+	*p++ = rec.back[i];
+    }
+    last = rec;
+    return  p - buf;
+}
+
+bool
+LogCodec::Decode(PipeLogRec* rec, const uint008_t* buf, size_t* len)
+{
+    const uint008_t*  p = buf;
+    const uint008_t*  end = buf + *len;
+    uint064_t  v;
+    if (p >= end) {
+	return  false;
+    }
+    int  flag = *p++;
+    PipeLogRec  r = PipeLogRec();
+    r.cycle = last.cycle + 1;
+    if (flag & CYCLE_DELTA) {
+	if (!GetVar(p, end, &v)) {
+	    return  false;
+	}
+	r.cycle = last.cycle + v;
+    }
+    r.fetched = last.fetched + ((flag & FETCH_ONE) ? 1 : 0);
+    if (flag & FETCH_DELTA) {
+	if (!GetVar(p, end, &v)) {
+	    return  false;
+	}
+	r.fetched = last.fetched + (uint032_t)v;
+    }
+    if (end - p < 5) {
+	return  false;
+    }
+    uint032_t  codes = p[0] | (p[1] << 8);
+    p += 2;
+    for (int i = 0; i < PipeLogRec::DEPTH; i++) {
+	uint008_t  s = p[i/2] >> (4*(i%2));
+	r.state[i] = (s & 0x03)
+	    | ((s & 0x04) ? PipeLogRec::EMPTY : 0)
+	    | ((s & 0x08) ? PipeLogRec::FULL : 0);
+    }
+    p += 3;
+    for (int i = 0; i < PipeLogRec::DEPTH; i++) {
+	int  how = (codes >> (2*i)) & 0x03;
+	int  from = (how == OP_SAME) ? i : i-1;
+	switch (how) {
+	case  OP_SAME:
+	case  OP_SHIFTED:
+	    if (from < 0) {
+		return  false;
+	    }
+	    r.pc[i] = last.pc[from];
+	    r.op[i] = last.op[from];
+	    r.back[i] = r.fetched-1 - last.Seq(from);
+	    break;
+	case  OP_NONE:
+	    break;
+	case  OP_FULL: {
+	    if (!GetVar(p, end, &v) || end - p < 5) {
+		return  false;
+	    }
+	    uint032_t  z = (uint032_t)v;
+	    r.pc[i] = last_pc + 4 + ((z >> 1) ^ -(z & 1));
+	    last_pc = r.pc[i];
+	    r.op[i] = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint032_t)p[3] << 24);
+	    r.back[i] = p[4];
+	    p += 5;
+	} break;
+	}
+    }
+    *rec = last = r;
+    *len = p - buf;
+    return  true;
+}
+
+LogWriter::LogWriter()
+{
+    fp = NULL;
+    bufs[0] = new uint008_t[LOG_BYTES];
+    bufs[1] = new uint008_t[LOG_BYTES];
+    filling = 0;
+    count = 0;
+    pending = 0;
+    closing = false;
+    started = false;
+    error = false;
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&cond, NULL);
+}
+
+LogWriter::~LogWriter()
+{
+    Close();
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&lock);
+    delete[]  bufs[0];
+    delete[]  bufs[1];
+}
+
+bool
+LogWriter::Open(const char* filename, bool compress)
+{
+    if ((fp = gzopen(filename, compress ? "wb1" : "wT")) == NULL) {
+	return false;
+    }
+    if (gzwrite((gzFile)fp, PIPEBINHEADER, sizeof(PIPEBINHEADER))
+	!= (int)sizeof(PIPEBINHEADER)) {
+	gzclose((gzFile)fp);
+	return false;
+    }
+    if (pthread_create(&thread, NULL, Run, this) != 0) {
+	perror("pthread_create");
+	abort();
+    }
+    started = true;
+    return true;
+}
+
+/* hands the full buffer to the thread, after the last one is written */
+void
+LogWriter::Swap()
+{
+    pthread_mutex_lock(&lock);
+    while (pending > 0) {
+	pthread_cond_wait(&cond, &lock);
+    }
+    pending = count;
+    filling ^= 1;
+    count = 0;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&lock);
+}
+
+void*
+LogWriter::Run(void* arg)
+{
+    LogWriter*  w = (LogWriter*)arg;
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+	while (w->pending == 0 && !w->closing) {
+	    pthread_cond_wait(&w->cond, &w->lock);
+	}
+	if (w->pending == 0) {
+	    break;
+	}
+	/* the buffer not being filled is the thread's until pending is 0 */
+	uint008_t*  buf = w->bufs[w->filling ^ 1];
+	size_t  n = w->pending;
+	bool  error = w->error;
+	pthread_mutex_unlock(&w->lock);
+	if (!error && gzwrite((gzFile)w->fp, buf, n) != (int)n) {
+	    error = true;
+	}
+	pthread_mutex_lock(&w->lock);
+	w->error = error;
+	w->pending = 0;
+	pthread_cond_broadcast(&w->cond);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return  NULL;
+}
+
+bool
+LogWriter::Close()
+{
+    if (!started) {
+	return  !error;
+    }
+    if (count > 0) {
+	Swap();
+    }
+    pthread_mutex_lock(&lock);
+    closing = true;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&lock);
+    pthread_join(thread, NULL);
+    if (gzclose((gzFile)fp) != Z_OK) {
+	error = true;
+    }
+    started = false;
+    return  !error;
+}
+
+LogReader::LogReader()
+{
+    fp = NULL;
+    buf = new uint008_t[LOG_BYTES];
+    pos = len = 0;
+}
+
+LogReader::~LogReader()
+{
+    if (fp) {
+	gzclose((gzFile)fp);
+    }
+    delete[]  buf;
+}
+
+bool
+LogReader::Open(const char* filename)
+{
+    char  header[sizeof(PIPEBINHEADER)];
+    if ((fp = gzopen(filename, "rb")) == NULL) {
+	return  false;
+    }
+    return  gzread((gzFile)fp, header, sizeof(header)) == (int)sizeof(header)
+	&& memcmp(header, PIPEBINHEADER, sizeof(header)) == 0;
+}
+
+bool
+LogReader::Get(PipeLogRec* rec)
+{
+    /* a record is decoded from at least MAX_REC bytes, or the rest */
+    if (len - pos < LogCodec::MAX_REC) {
+	memmove(buf, buf + pos, len - pos);
+	len -= pos;
+	pos = 0;
+	int  n = gzread((gzFile)fp, buf + len, LOG_BYTES - len);
+	if (n > 0) {
+	    len += n;
+	}
+    }
+    size_t  n = len - pos;
+    if (!codec.Decode(rec, buf + pos, &n)) {
+	return  false;
+    }
+    pos += n;
+    return  true;
+}
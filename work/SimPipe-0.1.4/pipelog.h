@@ -0,0 +1,116 @@
+/* -*-c++-*-
+ * SimPipe: a MIPS Pipeline Simulator using SimMips
+ *   Keiji Kimura
+ */
+
+#ifndef  PIPELOG_H
+#define  PIPELOG_H
+
+#ifndef  L_NAME
+#include  "define.h"
+#endif
+#include  <pthread.h>
+
+#define  PIPEBINNAME  "pipe.bin"
+#define  PIPEBINHEADER  "SimPipe_Log_2"
+
+/* one cycle of the binary pipeline log, as the text log shows it:
+   taken after the stages have run, before the latches are shifted */
+struct PipeLogRec {
+    enum { DEPTH = 5 };
+    enum { IDLE, BUSY, STALL }; /* the stage states of PipeLine */
+    enum { STATE = 0x0f,
+	   EMPTY = 0x40,   /* the latch shows no op */
+	   FULL  = 0x80 }; /* the latch contains its op */
+
+    uint064_t  cycle;
+    uint032_t  fetched;      /* ops fetched so far */
+    uint032_t  pc[DEPTH];
+    uint032_t  op[DEPTH];
+    uint008_t  back[DEPTH];  /* ops fetched after the stage's one */
+    uint008_t  state[DEPTH];
+
+    /* the op's number in fetch order, to follow it down the stages */
+    uint032_t Seq(int stage) const { return fetched-1 - back[stage]; }
+};
+
+/* The file is the header, then a record a cycle coded against the one
+   before it: a flag byte, the deltas of cycle and fetched if they are
+   not the usual ones, 2 bits a stage telling whether its op is the one
+   of the same or the previous stage a cycle ago, none, or given in
+   full, 4 bits a stage of state, and the ops given in full as the pc
+   delta, the op and back.  Numbers are varints or little-endian. */
+class LogCodec {
+public:
+    enum { MAX_REC = 80 }; /* bytes of a record at most */
+
+    LogCodec();
+    size_t Encode(const PipeLogRec& rec, uint008_t* buf);
+    bool Decode(PipeLogRec* rec, const uint008_t* buf, size_t* len);
+
+private:
+    enum { CYCLE_DELTA = 0x01,  /* the cycle is not the next one */
+	   FETCH_ONE   = 0x02,  /* an op was fetched */
+	   FETCH_DELTA = 0x04 };
+    enum { OP_SAME, OP_SHIFTED, OP_NONE, OP_FULL };
+
+    PipeLogRec  last;
+    uint032_t  last_pc; /* of the last op given in full */
+};
+
+/* writes the records in the background: the pipeline fills one buffer
+   while a thread writes the other one, into a gzip file if compressed */
+class LogWriter {
+public:
+    LogWriter();
+    ~LogWriter();
+
+    bool Open(const char* filename, bool compress);
+    void Put(const PipeLogRec& rec) {
+	count += codec.Encode(rec, bufs[filling] + count);
+	if (count + LogCodec::MAX_REC > LOG_BYTES) {
+	    Swap();
+	}
+    }
+    bool Close(); /* false if the file could not be written */
+
+private:
+    enum { LOG_BYTES = 0x100000 }; /* bytes a buffer */
+
+    static void* Run(void* arg);
+    void Swap();
+
+    LogCodec  codec;
+    void*  fp; /* gzFile */
+    uint008_t*  bufs[2];
+    int  filling;  /* the buffer Put goes into */
+    size_t  count;   /* bytes in it */
+    size_t  pending; /* bytes of the other one not written yet */
+    bool  closing;
+    bool  started;
+    bool  error;
+    pthread_mutex_t  lock;
+    pthread_cond_t  cond;
+    pthread_t  thread;
+};
+
+/* reads back what LogWriter wrote */
+class LogReader {
+public:
+    LogReader();
+    ~LogReader();
+
+    bool Open(const char* filename);
+    bool Get(PipeLogRec* rec);
+
+private:
+    enum { LOG_BYTES = 0x10000 };
+
+    LogCodec  codec;
+    void*  fp; /* gzFile */
+    uint008_t*  buf;
+    size_t  pos;
+    size_t  len;
+};
+
+#endif	// PIPELOG_H
@@ -0,0 +1,158 @@
+/* -*-c++-*-
+ * SimPipe: a MIPS Pipeline Simulator using SimMips
+ *   Keiji Kimura
+ */
+
+/* pipeview renders the binary log of "SimPipe -lb" as the text log of
+   "SimPipe -l", or with -k in the Kanata format of the Konata viewer. */
+
+#include  <cstdlib>
+#include  <cstring>
+#include  <map>
+#include  "pipelog.h"
+
+static const char*  stage_name[PipeLogRec::DEPTH] = {"F", "D", "E", "M", "W"};
+
+struct ViewOp {
+    uint032_t  id;    /* in the Kanata file */
+    int  stage;
+    int  held;        /* the state noted for it in the stage */
+    bool  seen;       /* in the cycle being rendered */
+};
+
+static void
+PutText(LogReader& log)
+{
+    PipeLogRec  rec;
+    MipsInst  name[PipeLogRec::DEPTH];
+
+    printf("        |        |   F   |   D   |   E   |   M   |   W   |\n");
+    while (log.Get(&rec)) {
+	for (int i = 0; i < PipeLogRec::DEPTH; i++) {
+	    name[i].op = rec.op[i];
+	}
+	printf("%6lld: |%8x|%7s|%7s|%7s|%7s|%7s|\n",
+	       (long long)rec.cycle,
+	       rec.pc[0],
+	       name[0].getinstname(),
+	       name[1].getinstname(),
+	       name[2].getinstname(),
+	       name[3].getinstname(),
+	       name[4].getinstname());
+    }
+}
+
+/* the ops not in the cycle have left from WriteBack, or were cut off
+   by the end of a window */
+static void
+Retire(std::map<uint032_t, ViewOp>& ops, bool all)
+{
+    std::map<uint032_t, ViewOp>::iterator  it = ops.begin();
+    while (it != ops.end()) {
+	ViewOp&  v = it->second;
+	if (v.seen && !all) {
+	    v.seen = false;
+	    ++it;
+	    continue;
+	}
+	printf("E\t%u\t0\t%s\n", v.id, stage_name[v.stage]);
+	printf("R\t%u\t%u\t%d\n", v.id, it->first,
+	       (v.stage == PipeLogRec::DEPTH-1) ? 0 : 1);
+	ops.erase(it++);
+    }
+}
+
+static void
+PutKanata(LogReader& log)
+{
+    PipeLogRec  rec;
+    MipsInst  name;
+    std::map<uint032_t, ViewOp>  ops; /* in flight, by seq */
+    uint032_t  next_id = 0;
+    bool  first = true;
+    uint064_t  last = 0;
+
+    printf("Kanata\t0004\n");
+    while (log.Get(&rec)) {
+	if (first) {
+	    printf("C=\t%lld\n", (long long)rec.cycle);
+	    first = false;
+	} else {
+	    if (rec.cycle != last+1) {
+		Retire(ops, true);
+	    }
+	    printf("C\t%lld\n", (long long)(rec.cycle - last));
+	}
+	last = rec.cycle;
+
+	for (int i = PipeLogRec::DEPTH-1; i >= 0; i--) {
+	    if (rec.state[i] & PipeLogRec::EMPTY) {
+		continue;
+	    }
+	    std::map<uint032_t, ViewOp>::iterator  it = ops.find(rec.Seq(i));
+	    if (it == ops.end()) {
+		ViewOp  v = {next_id++, -1, PipeLogRec::IDLE, false};
+		it = ops.insert(std::make_pair(rec.Seq(i), v)).first;
+		name.op = rec.op[i];
+		printf("I\t%u\t%u\t0\n", v.id, rec.Seq(i));
+		printf("L\t%u\t0\t%08x: %s\n", v.id, rec.pc[i],
+		       name.getinstname());
+	    }
+	    ViewOp&  v = it->second;
+	    v.seen = true;
+	    if (v.stage != i) {
+		if (v.stage >= 0) {
+		    printf("E\t%u\t0\t%s\n", v.id, stage_name[v.stage]);
+		}
+		printf("S\t%u\t0\t%s\n", v.id, stage_name[i]);
+		v.stage = i;
+		v.held = PipeLogRec::IDLE;
+	    }
+	    /* why the op is held, shown when the mouse is over it */
+	    int  state = rec.state[i] & PipeLogRec::STATE;
+	    if (state == PipeLogRec::BUSY && v.held != state) {
+		printf("L\t%u\t1\t%lld: data cache miss; \n",
+		       v.id, (long long)rec.cycle);
+		v.held = state;
+	    } else if (i == 1 && state == PipeLogRec::IDLE
+		       && (rec.state[i] & PipeLogRec::FULL)
+		       && v.held != PipeLogRec::STALL) {
+		printf("L\t%u\t1\t%lld: waiting for a source register; \n",
+		       v.id, (long long)rec.cycle);
+		v.held = PipeLogRec::STALL;
+	    }
+	}
+	Retire(ops, false);
+    }
+    Retire(ops, true);
+}
+
+int
+main(int argc, char** argv)
+{
+    bool  kanata = false;
+    const char*  filename = PIPEBINNAME;
+    LogReader  log;
+
+    for (int i = 1; i < argc; i++) {
+	if (strcmp(argv[i], "-k") == 0) {
+	    kanata = true;
+	} else if (argv[i][0] == '-') {
+	    printf("Usage: pipeview [-k] [log_file]\n"
+		   " -k: Output in the Kanata format for Konata\n");
+	    return  1;
+	} else {
+	    filename = argv[i];
+	}
+    }
+    if (!log.Open(filename)) {
+	fprintf(stderr, "Can't open binary pipe-log file %s\n", filename);
+	return  1;
+    }
+    if (kanata) {
+	PutKanata(log);
+    } else {
+	PutText(log);
+    }
+    return  0;
+}